@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Counters kept by the codec so the bandwidth saved can be weighed against the CPU spent
+struct CodecStats {
+    long framesEncoded;
+    long framesDecoded;
+    long bytesBefore;   // plain body bytes handed to encode()
+    long bytesAfter;    // encoded body bytes actually put on the wire
+    long encodeNanos;
+    long decodeNanos;
+
+    CodecStats() : framesEncoded(0), framesDecoded(0), bytesBefore(0), bytesAfter(0), encodeNanos(0), decodeNanos(0) {}
+};
+
+// Dictionary substitution codec for SEND/MESSAGE bodies.
+// Phrases from a fixed shared dictionary are replaced by a two byte token (ESCAPE, 0x20 + index),
+// so the encoded body stays 7-bit text without '\0' and passes through the STOMP server untouched.
+class BodyCodec {
+public:
+    // Value of the content-encoding header for bodies produced by encode()
+    static const std::string ENCODING_NAME;
+
+    BodyCodec();
+
+    // Returns the encoded body
+    std::string encode(const std::string &body);
+
+    // Decodes a body produced by encode(). Returns false if the body is not valid for this dictionary.
+    bool decode(const std::string &encoded, std::string &out);
+
+    const CodecStats &getStats() const { return stats; }
+    void resetStats() { stats = CodecStats(); }
+
+private:
+    static const char ESCAPE = '\x01';
+
+    // Dictionary entry indexes grouped by first byte, longest phrase first
+    std::vector<std::vector<int>> byFirstByte;
+    CodecStats stats;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+// Generated by DictTrainer from the sample event files (make dictionary), do not edit.
+// Regenerating changes the tokens: bump BodyCodec::ENCODING_NAME with it.
+static const char *const DICTIONARY[] = {
+    " updates:\n",
+    "\nteam a: Germany\nteam b:",
+    " Japan\nevent name: ",
+    "0\ngeneral game",
+    "description:\n",
+    " the ",
+    "possession: ",
+    "team ",
+    " Germany ",
+    "\ntime: ",
+    "goal",
+    "user: ",
+    " and ",
+    " to ",
+    " Gundogan ",
+    " Japan",
+    ", but ",
+    " a ",
+    " into",
+    "!!!",
+    " from",
+    " of",
+    "active: ",
+    " has s",
+    ", wh",
+    "AAALLL",
+    "half",
+    "ing ",
+    " corner",
+    "before ",
+    " Gonda",
+    " the",
+    "ball",
+    "ight ",
+    "s: 1\n",
+    " as ",
+    "lead",
+    " What",
+    " an e",
+    "after",
+    "final",
+    "is ",
+    "view,",
+    " in",
+    "GOOO",
+    "The ",
+    "kick",
+    "ning",
+    "tart",
+    " it",
+    "way",
+    " fo",
+    "ends",
+    "game",
+    "ong ",
+    "slot",
+    " an",
+    " at",
+    " be",
+    " do",
+    " on",
+    " up",
+    "ave",
+    "ed ",
+    "nal",
+    "put",
+    " po",
+    " wi",
+    "ack",
+    "an ",
+    "eve",
+    "iti",
+    "rea",
+    " pe",
+    " tr",
+    "! A",
+    "box",
+    "con",
+    "e l",
+    "e s",
+    "eed",
+    "est",
+    "hat",
+    "irs",
+    "les",
+    "off",
+    "ott",
+    "s a",
+    "tak",
+    "ura",
+};
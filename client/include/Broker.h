@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct BrokerConnection;
+class BrokerReactor;
+
+struct BrokerStats {
+    unsigned long connections;      // accepted so far
+    unsigned long framesIn;
+    unsigned long messagesOut;      // MESSAGE frames delivered to subscribers
+};
+
+// In-memory STOMP 1.2 broker with the semantics of the Java StompMessagingProtocolImpl, for load
+// tests and CI without the JVM: users are registered on first CONNECT and kept in memory only.
+// Each of the reactor threads owns an epoll set and the connections assigned to it; frames are
+// parsed with the client's frame parser. Any thread may deliver to any connection: output is
+// buffered per connection and flushed once per event loop pass, so a burst costs one write.
+class Broker {
+public:
+    // 0 threads means one per core
+    explicit Broker(size_t threads = 0);
+    ~Broker();
+
+    Broker(const Broker &) = delete;
+    Broker &operator=(const Broker &) = delete;
+
+    // Binds and listens on port. Returns false (and prints why) on failure.
+    bool listen(unsigned short port);
+
+    // Listens on a Unix-domain socket too, for clients on the same host. The file is removed on destruction.
+    bool listenUnix(const std::string &path);
+
+    // Serves an already connected socket, e.g. one end of a socketpair. The broker owns fd afterwards.
+    void adopt(int fd);
+
+    // Starts the reactor threads and returns
+    void start();
+
+    // Stops the reactors and closes every connection
+    void stop();
+
+    BrokerStats stats() const;
+
+private:
+    friend class BrokerReactor;
+
+    struct Subscriber {
+        std::shared_ptr<BrokerConnection> connection;
+        int subscriptionId;
+        bool needsAck;
+
+        Subscriber(const std::shared_ptr<BrokerConnection> &connection, int subscriptionId, bool needsAck)
+            : connection(connection), subscriptionId(subscriptionId), needsAck(needsAck) {}
+    };
+    typedef std::vector<Subscriber> SubscriberList;
+
+    struct User {
+        std::string password;
+        int connectionId;           // -1 when logged out
+
+        User() : password(), connectionId(-1) {}
+    };
+
+    enum LoginStatus { ADDED_NEW_USER, LOGGED_IN_SUCCESSFULLY, WRONG_PASSWORD, ALREADY_LOGGED_IN, CLIENT_ALREADY_CONNECTED };
+
+    LoginStatus login(int connectionId, const std::string &user, const std::string &password);
+    void logout(int connectionId);
+
+    // Subscriber lists are copied on write, so fan-out reads a snapshot without holding the lock
+    void subscribe(const std::shared_ptr<BrokerConnection> &connection, const std::string &channel, int subscriptionId, bool needsAck);
+    void unsubscribe(const BrokerConnection &connection, const std::string &channel);
+    std::shared_ptr<const SubscriberList> subscribers(const std::string &channel) const;
+
+    void assign(int fd);
+
+    size_t threadCount;
+    std::vector<std::unique_ptr<BrokerReactor>> reactors;
+    std::vector<int> listenFds;
+    std::vector<std::string> unixPaths;
+    std::atomic<int> nextConnectionId;
+    std::atomic<size_t> nextReactor;
+    std::atomic<long> nextMessageId;
+
+    mutable std::mutex usersMutex;
+    std::map<std::string, User> users;
+    std::unordered_map<int, std::string> connectionUsers;
+
+    mutable std::mutex channelsMutex;
+    std::unordered_map<std::string, std::shared_ptr<const SubscriberList>> channels;
+
+    std::atomic<unsigned long> connectionCount;
+    std::atomic<unsigned long> framesIn;
+    std::atomic<unsigned long> messagesOut;
+};
@@ -2,25 +2,66 @@
 
 #include <string>
 #include <iostream>
-#include <boost/asio.hpp>
-
-using boost::asio::ip::tcp;
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include "Transport.h"
 
 class ConnectionHandler {
 private:
-	const std::string host_;
-	const short port_;
-	boost::asio::io_service io_service_;   // Provides core I/O functionality
-	tcp::socket socket_;
+	// TCP, Unix-domain socket or shared memory, see Transport.h
+	std::unique_ptr<Transport> transport_;
+	SocketProfile profile_;
+
+	// Bytes received from the socket but not yet handed to the caller
+	char readBuffer_[4096];
+	size_t readPos_;
+	size_t readLen_;
+	int readTimeoutMs_;
+
+	// Serializes writers (user input thread and heart-beat thread)
+	std::mutex writeMutex_;
+	std::chrono::steady_clock::time_point lastWrite_;
+
+	std::thread heartbeatThread_;
+	std::mutex heartbeatMutex_;
+	std::condition_variable heartbeatCv_;
+	bool heartbeatRunning_;
+
+	// Refill readBuffer_ with a single read. Returns false on error or read timeout.
+	bool fillBuffer();
+
+	// Write all the bytes, the caller must hold writeMutex_
+	bool writeAll(const char bytes[], size_t bytesToWrite);
+
+	void heartbeatLoop(int intervalMs);
+
+	void applyProfile();
 
 public:
 	ConnectionHandler(std::string host, short port);
 
+	explicit ConnectionHandler(std::unique_ptr<Transport> transport);
+
 	virtual ~ConnectionHandler();
 
 	// Connect to the remote machine
 	bool connect();
 
+	// Use an already connected socket, e.g. one end of a socketpair, instead of connecting.
+	// The handler owns fd afterwards. Returns false if it cannot be used.
+	bool attach(int fd);
+
+	// Socket options applied on every connect and attach, see SocketTuning.h
+	void setProfile(const SocketProfile &profile);
+
+	// Frames sent between the two calls leave in full packets when the profile corks batches
+	void beginBatch();
+	void endBatch();
+
 	// Read a fixed number of bytes from the server - blocking.
 	// Returns false in case the connection is closed before bytesToRead bytes can be read.
 	bool getBytes(char bytes[], unsigned int bytesToRead);
@@ -39,12 +80,25 @@ public:
 
 	// Get Ascii data from the server until the delimiter character
 	// Returns false in case connection closed before null can be read.
+	// With '\0' as delimiter, EOL heart-beats between frames are skipped.
 	bool getFrameAscii(std::string &frame, char delimiter);
 
 	// Send a message to the remote host.
 	// Returns false in case connection is closed before all the data is sent.
 	bool sendFrameAscii(const std::string &frame, char delimiter);
 
+	// Drop the current socket, connect again and send the given frames ('\0' terminated)
+	// before any other writer can use the new connection. Returns false if any step fails.
+	bool reconnect(const std::vector<std::string> &resumeFrames);
+
+	// Make reads fail when nothing, not even a heart-beat, arrives within timeoutMs. 0 waits forever.
+	void setReadTimeout(int timeoutMs);
+
+	// Send an EOL heart-beat whenever nothing else was written for intervalMs. 0 only stops the heart-beat.
+	void startHeartbeat(int intervalMs);
+
+	void stopHeartbeat();
+
 	// Close down the connection properly.
 	void close();
 
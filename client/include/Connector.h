@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/system/error_code.hpp>
+
+struct BrokerEndpoint {
+    std::string host;       // name or literal address
+    unsigned short port;
+
+    BrokerEndpoint(const std::string &host, unsigned short port) : host(host), port(port) {}
+};
+
+// Gives up on connecting after this long, across every endpoint
+const int CONNECT_TIMEOUT_MS = 5000;
+
+// Parses "host:port[,host:port...]", IPv6 literals in brackets ([::1]:7777). False if any entry is malformed.
+bool parseBrokerList(const std::string &list, std::vector<BrokerEndpoint> &out);
+
+// The list back in the same syntax
+std::string describeBrokers(const std::vector<BrokerEndpoint> &brokers);
+
+// Connects to whichever broker answers first, happy eyeballs style (RFC 8305): every host is
+// resolved at once in the background, with answers cached for a minute, and a new attempt starts
+// every 250ms (or as soon as one fails), taking brokers in turn and alternating IPv6 and IPv4.
+// The first attempt to connect wins and the others are dropped.
+// Returns the connected socket, or -1 with error set (timed_out after timeoutMs).
+int connectFirst(const std::vector<BrokerEndpoint> &brokers, int timeoutMs, boost::system::error_code &error);
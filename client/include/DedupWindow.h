@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "StrView.h"
+
+// Duplicate detector for one subscription, with bounded memory however many events go through it.
+// Message IDs are checked against a sliding bitmap of the last idWindow IDs. Event contents are
+// checked against two generations of a flat hash set: when the current generation fills up it
+// replaces the previous one, so the last hashCapacity to 2 * hashCapacity events are remembered.
+class DedupWindow {
+public:
+    DedupWindow(size_t idWindow = 4096, size_t hashCapacity = 8192);
+
+    // Returns true if the ID was seen before, and remembers it otherwise.
+    // IDs older than the window cannot be decided and are reported as new.
+    bool seenId(long messageId);
+
+    // Returns true if the content hash was seen before, and remembers it otherwise
+    bool seenHash(uint64_t hash);
+
+    // Forgets all message IDs, e.g. when a new connection starts numbering again
+    void resetIds();
+
+    // 64-bit FNV-1a of the fields that identify a reported event
+    static uint64_t hashEvent(StrView user, StrView game, int time, StrView name);
+
+private:
+    static bool insert(std::vector<uint64_t> &table, uint64_t hash, size_t &count);
+    static bool contains(const std::vector<uint64_t> &table, uint64_t hash);
+
+    std::vector<uint64_t> idBits;
+    long highestId;
+
+    size_t hashCapacity;
+    std::vector<uint64_t> currentHashes;
+    std::vector<uint64_t> previousHashes;
+    size_t currentCount;
+};
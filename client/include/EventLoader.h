@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "event.h"
+#include "StructuralIndex.h"
+
+// Fast path for loading event files, in two stages like simdjson. Stage one classifies the text
+// 64 bytes at a time with the SIMD kernels of StructuralIndex.h and records where every
+// unescaped quote and every brace, bracket, colon and comma outside a string sits. Stage two walks
+// those positions knowing the event file schema and builds the Events directly, no JSON tree.
+//
+// Returns false, leaving out untouched, on anything it does not expect: other fields, nested or
+// floating point stat values, non-UTF-8 text, invalid JSON. parseEventsFile then uses nlohmann.
+bool parseEventsFast(const std::string &json, names_and_events &out);
+
+// Stage one on its own, for benchmarks. Returns false if the text is not plain ASCII / UTF-8 JSON
+// text the fast path can take (control characters, unterminated string).
+bool indexJson(ScanKernel kernel, const std::string &json, std::vector<uint32_t> &positions);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+// Field names of the event file schema, bound at compile time. A field name hashes to one of
+// FIELD_SLOTS slots with a hash picked to be collision free on this schema, so a key read from
+// the file costs a hash, a table load and one memcmp. static_asserts below keep it perfect if
+// the schema changes.
+enum class EventField {
+    TEAM_A,
+    TEAM_B,
+    EVENTS,
+    EVENT_NAME,
+    TIME,
+    GENERAL_UPDATES,
+    TEAM_A_UPDATES,
+    TEAM_B_UPDATES,
+    DESCRIPTION,
+    UNKNOWN
+};
+
+namespace event_schema {
+
+constexpr int FIELD_COUNT = static_cast<int>(EventField::UNKNOWN);
+constexpr unsigned FIELD_SLOTS = 16;
+
+constexpr const char *FIELD_NAMES[FIELD_COUNT] = {
+    "team a", "team b", "events",
+    "event name", "time", "general game updates", "team a updates", "team b updates", "description"
+};
+
+constexpr size_t length(const char *s) {
+    return *s ? 1 + length(s + 1) : 0;
+}
+
+// Length plus the 6th character ("team a" and "team b" differ there), or the last one for short names
+constexpr unsigned hash(const char *s, size_t n) {
+    return n == 0 ? 0 : (static_cast<unsigned>(n) + 3u * static_cast<unsigned char>(s[n > 5 ? 5 : n - 1])) & (FIELD_SLOTS - 1);
+}
+
+constexpr unsigned fieldHash(int field) {
+    return hash(FIELD_NAMES[field], length(FIELD_NAMES[field]));
+}
+
+// The field that hashes to slot, -1 if none
+constexpr int fieldInSlot(unsigned slot, int field = 0) {
+    return field == FIELD_COUNT ? -1 : fieldHash(field) == slot ? field : fieldInSlot(slot, field + 1);
+}
+
+constexpr bool collidesWithLater(int field, int other) {
+    return other < FIELD_COUNT && (fieldHash(field) == fieldHash(other) || collidesWithLater(field, other + 1));
+}
+
+constexpr bool perfect(int field = 0) {
+    return field == FIELD_COUNT || (!collidesWithLater(field, field + 1) && perfect(field + 1));
+}
+
+static_assert((FIELD_SLOTS & (FIELD_SLOTS - 1)) == 0, "slot count must be a power of two");
+static_assert(perfect(), "event schema field hash has a collision, pick other constants");
+
+constexpr signed char SLOT_TO_FIELD[FIELD_SLOTS] = {
+    fieldInSlot(0), fieldInSlot(1), fieldInSlot(2), fieldInSlot(3),
+    fieldInSlot(4), fieldInSlot(5), fieldInSlot(6), fieldInSlot(7),
+    fieldInSlot(8), fieldInSlot(9), fieldInSlot(10), fieldInSlot(11),
+    fieldInSlot(12), fieldInSlot(13), fieldInSlot(14), fieldInSlot(15)
+};
+
+}
+
+// Field named by the n bytes at s, UNKNOWN for anything outside the schema
+inline EventField lookupEventField(const char *s, size_t n) {
+    int field = event_schema::SLOT_TO_FIELD[event_schema::hash(s, n)];
+    if (field < 0) return EventField::UNKNOWN;
+    const char *name = event_schema::FIELD_NAMES[field];
+    return (std::strlen(name) == n && std::memcmp(name, s, n) == 0) ? static_cast<EventField>(field) : EventField::UNKNOWN;
+}
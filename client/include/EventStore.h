@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include "event.h"
+#include "StrView.h"
+#include "StringStore.h"
+
+// Append-only pool of T in fixed-size blocks. Elements never move once placed, growing the pool
+// only adds a block, and neighbouring elements share cache lines. Addressed by index.
+template <typename T, size_t BlockSize = 64>
+class Slab {
+public:
+    Slab() : blocks(), count(0) {}
+
+    uint32_t push(const T &value) {
+        if (count % BlockSize == 0) blocks.push_back(std::unique_ptr<T[]>(new T[BlockSize]));
+        blocks.back()[count % BlockSize] = value;
+        return static_cast<uint32_t>(count++);
+    }
+
+    const T &operator[](size_t index) const { return blocks[index / BlockSize][index % BlockSize]; }
+
+    size_t size() const { return count; }
+    size_t bytesReserved() const { return blocks.size() * BlockSize * sizeof(T); }
+
+private:
+    std::vector<std::unique_ptr<T[]>> blocks;
+    size_t count;
+};
+
+// Maps short strings that repeat across events (event names, stat keys and values) to dense IDs
+class StringInterner {
+public:
+    StringInterner() : ids(), strings() {}
+    StringInterner(StringInterner &&) = default;
+    StringInterner &operator=(StringInterner &&) = default;
+
+    uint32_t intern(const std::string &s);
+    const std::string &lookup(uint32_t id) const { return *strings[id]; }
+
+    size_t size() const { return strings.size(); }
+    size_t bytesUsed() const;
+
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<const std::string *> strings;   // points at the keys of ids, which never move
+};
+
+// One stat update carried by an event
+struct StatDelta {
+    uint8_t section;    // StatView::Section
+    uint32_t keyId;
+    uint32_t valueId;
+};
+
+// Compact form of a retained event. Team names live once in the game, strings live in the store.
+struct StoredEvent {
+    int time;
+    uint32_t nameId;
+    uint32_t descriptionId;     // in the store's description StringStore
+    uint32_t firstStat;     // stats are a run in the store's stat slab
+    uint32_t statCount;
+};
+
+// Every event retained for one game, in a few contiguous pools instead of one heap object per event
+class EventStore {
+public:
+    EventStore();
+    EventStore(EventStore &&) = default;
+    EventStore &operator=(EventStore &&) = default;
+    EventStore(const EventStore &) = delete;
+    EventStore &operator=(const EventStore &) = delete;
+
+    // Returns the index of the stored event
+    uint32_t add(const Event &event);
+
+    const StoredEvent &get(uint32_t index) const { return events[index]; }
+    const std::string &name(const StoredEvent &event) const { return strings.lookup(event.nameId); }
+    // Valid until the next add
+    StrView description(const StoredEvent &event) const;
+
+    size_t size() const { return events.size(); }
+    size_t bytesUsed() const;
+    StringStoreStats descriptionStats() const { return descriptions.stats(); }
+
+private:
+    void addStats(const std::map<std::string, std::string> &updates, uint8_t section);
+
+    Slab<StoredEvent> events;
+    Slab<StatDelta, 256> stats;
+    StringInterner strings;
+    StringStore descriptions;   // shared by identical events from different reporters
+};
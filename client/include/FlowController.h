@@ -0,0 +1,47 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+// Credit window for bulk uploads: at most getWindow() frames may be sent but not yet confirmed by a receipt.
+// The window grows additively while receipt round trips stay near the best one seen, and is halved
+// (at most once per round trip) when they stretch out or a receipt is lost, so one uploader backs off
+// before it fills the broker's queues.
+class FlowController {
+public:
+    FlowController(int minWindow, int initialWindow, int maxWindow);
+
+    // Blocks until one more frame fits in the window
+    void acquire();
+
+    // A frame that went through acquire() was written to the socket
+    void sent();
+
+    // A receipt confirmed 'frames' frames, rttMicros after the frame carrying it was sent
+    void onAck(int frames, long rttMicros);
+
+    // A receipt covering 'frames' frames never arrived
+    void onLoss(int frames);
+
+    // Drops all in-flight accounting and starts over with the given window bounds
+    void reset(int minWindow, int initialWindow, int maxWindow);
+
+    int getWindow() const;
+    int getInFlight() const;
+    long getSmoothedRttMicros() const;
+    long getBaseRttMicros() const;
+
+private:
+    void decrease();
+
+    mutable std::mutex mutex;
+    std::condition_variable creditCv;
+    int minWindow;
+    int maxWindow;
+    double window;
+    int inFlight;
+    long smoothedRtt;
+    long baseRtt;
+    std::chrono::steady_clock::time_point lastDecrease;
+};
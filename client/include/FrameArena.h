@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+// Monotonic bump allocator for data that only lives while one frame is processed.
+// Nothing is freed individually: reset() rewinds to the first chunk in O(1) and keeps every chunk
+// for the next frame, so steady state parsing does not touch the heap at all.
+// Only trivially destructible types may be placed in it, no destructors are ever run.
+class FrameArena {
+public:
+    explicit FrameArena(size_t chunkSize = 16 * 1024);
+    ~FrameArena();
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void *allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T *allocateArray(size_t count) {
+        return static_cast<T *>(allocate(sizeof(T) * (count > 0 ? count : 1), alignof(T)));
+    }
+
+    void reset();
+
+    // Bytes handed out since the last reset / bytes held in chunks
+    size_t bytesUsed() const { return used; }
+    size_t capacity() const;
+
+private:
+    size_t chunkSize;
+    std::vector<std::pair<char *, size_t>> chunks;   // start, size
+    size_t current;     // chunk being filled
+    size_t offset;      // first free byte in the current chunk
+    size_t used;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Capture files hold the frames the client received, in order, for StompReplay:
+//   "STOMPCAP", a version byte, the capture start as microseconds since the epoch (8 bytes, little endian),
+//   then per frame: nanoseconds since the previous frame and the frame length as varints, the frame bytes.
+// Frames are stored without their '\0' terminator.
+
+struct CapturedFrame {
+    uint64_t offsetNs;      // since the capture started
+    std::string frame;
+
+    CapturedFrame() : offsetNs(0), frame() {}
+};
+
+// Records frames from the listener thread while another thread may start or stop the capture.
+// Records are buffered and written out every 64 KB or once a second, whichever comes first.
+class FrameCaptureWriter {
+public:
+    FrameCaptureWriter();
+    ~FrameCaptureWriter();
+
+    FrameCaptureWriter(const FrameCaptureWriter &) = delete;
+    FrameCaptureWriter &operator=(const FrameCaptureWriter &) = delete;
+
+    // Ends any running capture and starts one in path. Returns false if the file cannot be created.
+    bool start(const std::string &path);
+
+    // Writes out what is buffered and closes the file. Returns the number of frames captured.
+    unsigned long stop();
+
+    bool active() const { return capturing.load(std::memory_order_relaxed); }
+
+    // Timestamps frame now. A no-op, without taking the lock, when no capture is running.
+    void record(const std::string &frame);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void flush();
+
+    std::atomic<bool> capturing;
+    std::mutex mutex;
+    std::ofstream out;
+    std::vector<char> buffer;
+    Clock::time_point last;
+    Clock::time_point lastFlush;
+    unsigned long frames;
+};
+
+// Reads a capture file front to back
+class FrameCaptureReader {
+public:
+    FrameCaptureReader();
+
+    // Returns false, with a message in error, if path is not a capture file
+    bool open(const std::string &path, std::string &error);
+
+    // False at the end of the file, or on a truncated or corrupt record (a capture cut short by a crash)
+    bool next(CapturedFrame &out);
+
+    uint64_t startMicros() const { return startUs; }
+
+private:
+    bool readVarint(uint64_t &value);
+
+    std::ifstream in;
+    uint64_t fileSize;
+    uint64_t startUs;
+    uint64_t offsetNs;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "StompProtocol.h"
+#include "TimerWheel.h"
+
+// Writes frames at their sendAfterMs from a thread of its own, for the replay command. Every
+// scheduled frame of every game sits in one TimerWheel with a 1 ms tick, so hundreds of games
+// replaying at once cost one thread and O(1) per frame. The thread sleeps until the exact start of
+// the next tick while frames are waiting, and not at all otherwise. Frames due in the same tick are
+// written in the order they were scheduled.
+class FramePacer {
+public:
+    // Writes one frame, false if the connection refused it
+    typedef std::function<bool(const OutgoingFrame &)> Sender;
+
+    explicit FramePacer(Sender sender);
+    ~FramePacer();
+
+    FramePacer(const FramePacer &) = delete;
+    FramePacer &operator=(const FramePacer &) = delete;
+
+    // Schedules each frame sendAfterMs from now
+    void schedule(std::vector<OutgoingFrame> frames);
+
+    // Unschedules everything still waiting and returns it
+    std::vector<OutgoingFrame> cancelAll();
+
+    // Blocks until every scheduled frame has been written, the ones being written right now included
+    void waitIdle();
+
+    // Frames waiting on the wheel or being written
+    size_t pending() const;
+
+    // Stops the thread once a write in progress is done; nothing is written afterwards
+    void stop();
+
+private:
+    struct Scheduled {
+        OutgoingFrame frame;
+        TimerWheel::Clock::time_point due;
+        unsigned long timerId;
+
+        Scheduled(OutgoingFrame frame, TimerWheel::Clock::time_point due)
+            : frame(std::move(frame)), due(due), timerId(0) {}
+    };
+
+    void run();
+    void printRun();
+
+    Sender sender;
+    mutable std::mutex mutex;
+    std::condition_variable wakeCv;
+    std::condition_variable idleCv;
+    TimerWheel wheel;
+    // Frames on the wheel by a key of their own; the wheel's callbacks only move keys to dueKeys
+    std::map<unsigned long, Scheduled> waiting;
+    std::vector<unsigned long> dueKeys;
+    unsigned long nextKey;
+    // Due frames taken off waiting and being written outside the lock
+    size_t inFlight;
+    // How late each frame of the current run was written, in microseconds
+    std::vector<double> lateness;
+    size_t failed;
+    bool running;
+    std::thread worker;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FrameArena.h"
+
+struct MockBrokerStats {
+    unsigned long framesIn;     // frames received from the client
+    unsigned long framesOut;    // replies and replayed frames written
+    unsigned long bytesOut;
+};
+
+// Scripted STOMP server on one end of a socketpair, so the client can be benchmarked end to end
+// with no server process. It answers CONNECT with CONNECTED and every frame carrying a receipt
+// header with its RECEIPT, keeps track of subscriptions, and replays frames handed to replay() at
+// a fixed rate. Replies go out ahead of replayed frames still waiting.
+class MockBroker {
+public:
+    MockBroker();
+    ~MockBroker();
+
+    MockBroker(const MockBroker &) = delete;
+    MockBroker &operator=(const MockBroker &) = delete;
+
+    // The client end of the socketpair, for ConnectionHandler::attach. The caller owns it afterwards.
+    int takeClientFd();
+
+    void start();
+
+    // Stops answering and closes the broker end
+    void stop();
+
+    // Queues frames (without their '\0') to be written at framesPerSecond, 0 for as fast as the client reads
+    void replay(const std::vector<std::string> &frames, double framesPerSecond);
+
+    // Blocks until every replayed frame was written or the client went away
+    void waitReplayed();
+
+    // Blocks until the client subscribed to destination. Returns the subscription ID, -1 on timeout.
+    int waitForSubscription(const std::string &destination, int timeoutMs);
+
+    MockBrokerStats stats() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void readLoop();
+    void writeLoop();
+    void handle(const std::string &frame);
+
+    int serverFd;
+    int clientFd;
+    std::thread reader;
+    std::thread writer;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    bool running;
+    std::deque<std::string> replies;
+
+    // Replay script: frames before scriptPos are written; pacing counts from scriptStart at scriptBase
+    std::vector<std::string> script;
+    size_t scriptPos;
+    size_t scriptWritten;
+    size_t scriptBase;
+    double rate;
+    Clock::time_point scriptStart;
+
+    std::map<std::string, int> subscriptions;     // destination -> subscription ID
+
+    std::atomic<unsigned long> framesIn;
+    std::atomic<unsigned long> framesOut;
+    std::atomic<unsigned long> bytesOut;
+
+    // Scratch memory for the frame handle() is parsing, rewound for every frame (reader thread only)
+    FrameArena arena;
+};
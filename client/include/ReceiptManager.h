@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <memory>
+#include <condition_variable>
+#include "TimerWheel.h"
+
+// Tracks frames sent with a receipt header until the server confirms them or they time out.
+// Completion is reported through a future and an optional callback. Callbacks run without
+// the manager's lock held: on the thread that called complete() or on the timer thread.
+class ReceiptManager {
+public:
+    // confirmed is false on timeout or cancel. rttMicros is the time since expect() (or the last rearm()).
+    typedef std::function<void(bool confirmed, long rttMicros)> Callback;
+
+    explicit ReceiptManager(int tickMs = 10);
+    ~ReceiptManager();
+
+    // Starts waiting for receiptId. The future resolves to true when the RECEIPT arrives. Without armNow the
+    // timeout only starts with restart(), for frames written long after they are built (paced replay).
+    std::shared_future<bool> expect(int receiptId, const std::string &action, int timeoutMs, Callback callback = Callback(),
+                                    bool armNow = true);
+
+    // Resolves a receipt. Returns false if it is unknown (already completed, timed out or never expected).
+    bool complete(int receiptId, std::string &action);
+
+    bool isPending(int receiptId) const;
+    size_t pendingCount() const;
+
+    // Action and age (ms) of every pending receipt, oldest receipt ID first
+    std::map<int, std::pair<std::string, long>> snapshot() const;
+
+    // Restarts the timeout and round trip clock of one receipt, e.g. when its frame is finally written
+    void restart(int receiptId);
+
+    // Restarts every armed timeout from now, e.g. after the frames were resent on a new connection
+    void rearm();
+
+    // Forgets a receipt whose frame will not be sent after all: the future resolves to false, the callback does not run
+    void cancel(int receiptId);
+
+    // Fails every pending receipt
+    void cancelAll();
+
+private:
+    struct Pending {
+        std::string action;
+        int timeoutMs;
+        bool armed;
+        unsigned long timerId;
+        TimerWheel::Clock::time_point sentAt;
+        std::shared_ptr<std::promise<bool>> promise;
+        Callback callback;
+
+        Pending() : action(), timeoutMs(0), armed(false), timerId(0), sentAt(), promise(), callback() {}
+    };
+
+    void expire(int receiptId);
+    void restartLocked(int receiptId, Pending &entry, TimerWheel::Clock::time_point now);
+    void tickLoop();
+
+    mutable std::mutex mutex;
+    std::condition_variable tickCv;
+    std::map<int, Pending> pending;
+    TimerWheel wheel;
+    bool running;
+    std::thread ticker;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "Transport.h"
+
+// Two single-producer single-consumer byte rings in a POSIX shared memory segment, one per
+// direction, for a client and broker on the same host. Each side spins briefly when its ring is
+// empty (or full) and then sleeps on a futex in the segment; a writer only makes the wake-up call
+// when the other side is actually asleep, so a busy stream costs no system calls at all.
+//
+// The SERVER side creates the segment and its connect() waits for one CLIENT to attach. A segment
+// carries one connection: close() marks it closed for good, so there is no reconnecting over it.
+// No broker listens on shared memory, so login does not offer it; TransportBench measures it.
+class ShmTransport : public Transport {
+public:
+    enum Role { CLIENT, SERVER };
+
+    ShmTransport(const std::string &name, Role role);
+    ~ShmTransport();
+
+    ShmTransport(const ShmTransport &) = delete;
+    ShmTransport &operator=(const ShmTransport &) = delete;
+
+    void connect(boost::system::error_code &error) override;
+    size_t readSome(char *buffer, size_t size, int timeoutMs, boost::system::error_code &error) override;
+    void write(const char *first, size_t firstSize, const char *second, size_t secondSize,
+               boost::system::error_code &error) override;
+    void close() override;
+    std::string describe() const override;
+
+    static const size_t RING_BYTES = 1 << 20;
+
+private:
+    struct Ring;
+    struct Segment;
+
+    void map(int fd, boost::system::error_code &error);
+    void unmap();
+    size_t writeSome(const char *bytes, size_t size, boost::system::error_code &error);
+
+    std::string name_;
+    Role role_;
+    Segment *segment_;
+    Ring *in_;
+    Ring *out_;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Socket options chosen together, by name at login (login {address} {user} {password} [profile]):
+//   default      what the kernel gives, as before
+//   low-latency  no Nagle, immediate ACKs, busy polling on reads
+//   bulk         large buffers, frames of one command corked into full packets
+struct SocketProfile {
+    std::string name;
+    bool noDelay;           // TCP_NODELAY
+    int sendBuffer;         // SO_SNDBUF bytes, 0 keeps the kernel's
+    int receiveBuffer;      // SO_RCVBUF bytes, 0 keeps the kernel's
+    bool quickAck;          // TCP_QUICKACK, re-armed after every read since the kernel drops it
+    int busyPollUs;         // SO_BUSY_POLL, 0 off
+    bool corkBatches;       // TCP_CORK around the frames of one command
+
+    SocketProfile()
+        : name("default"), noDelay(false), sendBuffer(0), receiveBuffer(0), quickAck(false), busyPollUs(0),
+          corkBatches(false) {}
+};
+
+// False if there is no profile of that name
+bool findSocketProfile(const std::string &name, SocketProfile &out);
+
+std::vector<std::string> socketProfileNames();
+
+// Applies profile to fd; TCP-only options are skipped unless tcp. Returns a message for every option
+// the kernel refused (SO_BUSY_POLL needs CAP_NET_ADMIN on some systems).
+std::vector<std::string> applySocketProfile(int fd, const SocketProfile &profile, bool tcp);
+
+void setCork(int fd, bool on);
+void rearmQuickAck(int fd);
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include "StrView.h"
+#include "FrameArena.h"
+#include "StructuralIndex.h"
+
+struct HeaderView {
+    StrView name;
+    StrView value;
+};
+
+// Zero-copy view of a received STOMP frame: every field points into the frame string,
+// the header array lives in the arena the frame was parsed with.
+struct FrameView {
+    StrView command;
+    HeaderView *headers;
+    size_t headerCount;
+    StrView body;
+    StructuralIndex index;  // of the whole frame, body parsers reuse it
+
+    FrameView() : command(), headers(nullptr), headerCount(0), body(), index() {}
+
+    // Value of the named header, or nullptr. A repeated header resolves to its last value.
+    const StrView *header(const char *name) const;
+
+    // Value of the named header copied out, or fallback
+    std::string headerOr(const char *name, const std::string &fallback) const;
+};
+
+// Splits a frame (without its '\0' terminator) into command, headers and body.
+// Returns false if there is no command line.
+bool parseFrame(const std::string &frame, FrameArena &arena, FrameView &out);
+bool parseFrame(StrView frame, FrameArena &arena, FrameView &out);
@@ -5,7 +5,17 @@
 #include <map>
 #include <iostream>
 #include <mutex>
+#include <condition_variable>
+#include <future>
 #include "event.h" 
+#include "BodyCodec.h"
+#include "ReceiptManager.h"
+#include "FlowController.h"
+#include "DedupWindow.h"
+#include "FrameArena.h"
+#include "StompFrame.h"
+#include "EventStore.h"
+#include "WorkerPool.h"
 
 // Struct to hold the state of a specific game
 struct GameState {
@@ -15,16 +25,67 @@ struct GameState {
     std::map<std::string, std::string> team_a_stats;
     std::map<std::string, std::string> team_b_stats;
     
-    // Map user -> list of events reported by them (required for summary command)
-    std::map<std::string, std::vector<Event>> reports; 
+    // Every retained event of the game, pooled
+    EventStore store;
 
-    GameState() = default;
-    GameState(std::string a, std::string b) : team_a(a), team_b(b) {}
+    // Map user -> indices in store of the events reported by them (required for summary command)
+    std::map<std::string, std::vector<uint32_t>> reports; 
+
+    GameState() : team_a(), team_b(), general_stats(), team_a_stats(), team_b_stats(), store(), reports() {}
+    GameState(std::string a, std::string b)
+        : team_a(a), team_b(b), general_stats(), team_a_stats(), team_b_stats(), store(), reports() {}
+};
+
+// Stats this client last reported for a game, so delta reports only carry what changed
+struct DeltaState {
+    int eventsSinceKeyframe;
+    std::map<std::string, std::string> general_stats;
+    std::map<std::string, std::string> team_a_stats;
+    std::map<std::string, std::string> team_b_stats;
+
+    DeltaState() : eventsSinceKeyframe(0), general_stats(), team_a_stats(), team_b_stats() {}
+};
+
+// A frame ready to be written, with what the sender needs to know about it
+struct OutgoingFrame {
+    std::string frame;
+    int receiptId;          // receipt requested by the frame, -1 if none
+    bool flowControlled;    // must wait for send credit (see StompProtocol::waitToSend)
+    // Resolves to true when the receipt arrives, false when it times out. Only valid with a receiptId.
+    std::shared_future<bool> confirmed;
+    // Paced replay: when to write the frame, in ms after the command. -1 writes it right away.
+    int sendAfterMs;
+    // Paced replay: the event the frame reports, applied to the game state once written (see frameSent)
+    int pacedEventId;
+
+    OutgoingFrame(const std::string& frame, int receiptId = -1, bool flowControlled = false,
+                  std::shared_future<bool> confirmed = std::shared_future<bool>())
+        : frame(frame), receiptId(receiptId), flowControlled(flowControlled), confirmed(confirmed), sendAfterMs(-1), pacedEventId(-1) {}
+};
+
+// A replayed event waiting for its frame to be written
+struct PacedEvent {
+    std::string gameName;
+    std::string reporter;
+    Event event;
+
+    PacedEvent(const std::string& gameName, const std::string& reporter, const Event& event)
+        : gameName(gameName), reporter(reporter), event(event) {}
+};
+
+// An events file read for the report command
+struct ReportFile {
+    std::string path;
+    names_and_events data;
+    bool parsed;
+
+    ReportFile() : path(), data(), parsed(false) {}
 };
 
 class StompProtocol {
 private:
     std::string currentUserName;
+    std::string currentPasscode;
     int subscriptionIdCounter;
     int receiptIdCounter;
     bool isConnected;
@@ -35,37 +96,130 @@ private:
 
     // Stores game data for the Summary command
     std::map<std::string, GameState> games;
+    // Replayed events by pacedEventId, kept out of games until the pacer writes their frame
+    std::map<int, PacedEvent> pacedEvents;
+    int pacedEventCounter;
 
-    // Maps receipt-id to the action it confirms
-    std::map<int, std::string> pendingReceipts;
+    // Windowed report uploads (flow command): a receipt every flowBatch frames drives the window.
+    // Declared before receipts, whose pending callbacks still reach it while shutting down.
+    bool flowControl;
+    int flowBatch;
+    FlowController flow;
+
+    // Receipts still expected from the server, with the action each one confirms
+    ReceiptManager receipts;
+    // Report frames get a receipt every reportReceiptEvery frames (receipts command), 0 disables
+    int reportReceiptEvery;
+    // Receipts still pending for SUBSCRIBE frames, by subscription ID
+    std::map<int, int> subIdToPendingReceipt;
+    // UNSUBSCRIBE / DISCONNECT frames still waiting for their receipt, replayed after a reconnect
+    std::map<int, std::string> receiptFrames;
+
+    // Subscriptions that acknowledge explicitly: sub ID -> "client" or "client-individual"
+    std::map<int, std::string> subIdToAckMode;
+    // Ack IDs of processed messages not yet acknowledged, per subscription
+    std::map<int, std::vector<std::string>> unackedMessages;
+    size_t unackedCount;
+
+    // Drops re-delivered and re-published events, per subscription ID
+    std::map<int, DedupWindow> dedup;
+
+    // Guards the state above, user input and server frames are handled on different threads
+    std::mutex stateMutex;
+    // Signalled when the server answers CONNECT, see waitForLogin
+    std::condition_variable loginCv;
+    bool loginAnswered;
+
+    // Scratch memory for the frame being processed, rewound at the start of every frame
+    FrameArena frameArena;
+
+    // Opt-in dictionary compression of report bodies (compress command)
+    bool compressBodies;
+    BodyCodec codec;
+
+    // Delta-encoded reports (delta command): every keyframeInterval-th event is sent in full
+    bool deltaReports;
+    int keyframeInterval;
+    std::map<std::string, DeltaState> sentState;
+
+    // Heart-beat intervals agreed on in CONNECTED, waiting to be applied to the connection
+    int heartbeatSendMs;
+    int heartbeatReceiveMs;
+    bool heartbeatNegotiated;
+
+    // Parses report files in parallel, one thread per core
+    WorkerPool workers;
 
 public:
     StompProtocol();
 
     // Processes user input and returns a vector of frames to send
-    std::vector<std::string> processUserInput(std::string line);
+    std::vector<OutgoingFrame> processUserInput(std::string line);
+
+    // Call right before writing a frame: blocks until a flow controlled frame fits in the send window,
+    // and starts the frame's receipt clock. Must not be called from the thread reading server frames.
+    void waitToSend(const OutgoingFrame& frame);
 
     // Processes a received frame. Returns true if connection should terminate.
     bool processServerFrame(std::string frame);
 
+    // Call once a frame is written: a replayed event only counts towards the game state from then on
+    void frameSent(const OutgoingFrame& frame);
+
+    // Call for a frame that will not be written after all, e.g. a paced frame still waiting at logout
+    void dropFrame(const OutgoingFrame& frame);
+
+    // Blocks until the server answers the last CONNECT with CONNECTED or ERROR, or timeoutMs passes.
+    // Returns whether the client is logged in.
+    bool waitForLogin(int timeoutMs);
+
     // Getters / Setters
     bool getIsConnected() const { return isConnected; }
     void setConnected(bool status) { isConnected = status; }
     std::string getCurrentUser() const { return currentUserName; }
 
+    // Frames that restore the session on a fresh connection: CONNECT with the same credentials,
+    // SUBSCRIBE with the same IDs for every joined channel and any frame still waiting for a receipt
+    std::vector<std::string> buildResumeFrames();
+
+    // ACK frames for processed messages, coalesced into a single write. Without force, returns nothing
+    // until enough messages are waiting; call it with force on a timer so the rest is acknowledged too.
+    std::vector<OutgoingFrame> takeAckFrames(bool force);
+
+    // Returns true once per CONNECTED frame, with how often to send heart-beats and how long
+    // to wait for incoming data before the connection is considered dead (0 disables either)
+    bool takeHeartbeat(int& sendEveryMs, int& receiveTimeoutMs);
+
 private:
     // Command Handlers
     std::string handleLogin(const std::vector<std::string>& args);
-    std::string handleJoin(const std::vector<std::string>& args);
-    std::string handleExit(const std::vector<std::string>& args);
-    std::vector<std::string> handleReport(const std::vector<std::string>& args);
+    OutgoingFrame handleJoin(const std::vector<std::string>& args);
+    OutgoingFrame handleExit(const std::vector<std::string>& args);
+    // speed > 0 paces the frames by event time (replay command), the game's first event going out right away
+    std::vector<OutgoingFrame> handleReport(const std::vector<ReportFile>& files, double speed = 0);
+    std::vector<OutgoingFrame> handleReplay(const std::vector<std::string>& args, const std::vector<ReportFile>& files);
     void handleSummary(const std::vector<std::string>& args);
-    std::string handleLogout(const std::vector<std::string>& args);
+    // Every user's summary of every game into a directory, rendered and written in parallel
+    void handleSummaryAll(const std::vector<std::string>& args);
+    OutgoingFrame handleLogout(const std::vector<std::string>& args);
+    void handleCompress(const std::vector<std::string>& args);
+    void handleDelta(const std::vector<std::string>& args);
+    void handleReceipts(const std::vector<std::string>& args);
+    void handleFlow(const std::vector<std::string>& args);
+    void handleMemory(const std::vector<std::string>& args);
 
     // Server Frame Handlers
-    void handleServerMessage(const std::string& body, const std::map<std::string, std::string>& headers);
+    void handleServerMessage(const FrameView& frame);
 
     // Helpers
+    std::vector<ReportFile> loadReportFiles(const std::vector<std::string>& args);
+    void appendGameReport(const std::string& gameName, const std::vector<std::pair<const Event*, const std::string*>>& events,
+                          std::vector<OutgoingFrame>& frames, double speed);
     std::string buildFrame(std::string command, std::map<std::string, std::string> headers, std::string body);
+    void recordAck(const FrameView& frame);
+    int expectReceipt(const std::string& action, ReceiptManager::Callback onDone = ReceiptManager::Callback(),
+                      std::shared_future<bool>* receiptFuture = nullptr, bool armNow = true);
+    void negotiateHeartbeat(const std::string& serverHeader);
+    std::string buildEventBody(const std::string& gameName, const Event& event);
     void updateGameStats(std::string gameName, const Event& event, std::string reporter);
 };
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+
+// Non-owning view of a run of characters, for parsing frames without copying them.
+// The viewed buffer must outlive the view.
+struct StrView {
+    const char *data;
+    size_t size;
+
+    StrView() : data(nullptr), size(0) {}
+    StrView(const char *data, size_t size) : data(data), size(size) {}
+    explicit StrView(const std::string &s) : data(s.data()), size(s.size()) {}
+
+    bool empty() const { return size == 0; }
+    std::string str() const { return std::string(data, size); }
+
+    bool equals(const char *s) const {
+        size_t length = std::strlen(s);
+        return length == size && std::memcmp(data, s, size) == 0;
+    }
+
+    bool startsWith(const char *prefix) const {
+        size_t length = std::strlen(prefix);
+        return length <= size && std::memcmp(data, prefix, length) == 0;
+    }
+
+    // Returns npos when c is not in the view
+    size_t find(char c, size_t from = 0) const {
+        if (from >= size) return std::string::npos;
+        const void *hit = std::memchr(data + from, c, size - from);
+        return hit ? static_cast<const char *>(hit) - data : std::string::npos;
+    }
+
+    StrView substr(size_t pos, size_t count = std::string::npos) const {
+        if (pos > size) pos = size;
+        if (count > size - pos) count = size - pos;
+        return StrView(data + pos, count);
+    }
+
+    // Drops the space that follows "key:" in report bodies
+    StrView trimLeadingSpace() const {
+        return (size > 0 && data[0] == ' ') ? StrView(data + 1, size - 1) : *this;
+    }
+
+    StrView trimTrailingCr() const {
+        return (size > 0 && data[size - 1] == '\r') ? StrView(data, size - 1) : *this;
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "StrView.h"
+
+struct StringStoreStats {
+    size_t strings;             // distinct strings held
+    size_t references;          // acquire calls they answer
+    size_t bytesStored;         // text actually kept
+    size_t bytesReferenced;     // text that one copy per reference would take
+    size_t bytesReserved;       // everything the store holds, index included
+};
+
+// Content-addressed store for long strings that repeat, such as event descriptions re-reported by
+// several users. Identical text is kept once in a shared slab: acquire() hashes the text, returns
+// the ID of an identical entry if there is one and counts the extra reference.
+class StringStore {
+public:
+    StringStore();
+
+    uint32_t acquire(StrView text);
+
+    // Valid until the next acquire
+    StrView get(uint32_t id) const;
+
+    StringStoreStats stats() const;
+
+private:
+    struct Entry {
+        uint64_t hash;
+        uint32_t offset;
+        uint32_t length;
+        uint32_t refs;
+    };
+
+    static uint64_t hashText(StrView text);
+    void growIndex();
+
+    std::string slab;               // every distinct string back to back
+    std::vector<Entry> entries;     // indexed by ID
+    std::vector<uint32_t> index;    // open addressing on hash, holds ID + 1, 0 is empty
+    size_t references;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "StrView.h"
+#include "FrameArena.h"
+
+// Byte scanners that find every '\n', ':' and '\0' in a buffer. The SIMD kernels compare 16 or 32 bytes
+// at a time; the best one the CPU supports is picked at runtime, the scalar one works everywhere.
+enum class ScanKernel { SCALAR, SSE2, AVX2 };
+
+bool scanKernelSupported(ScanKernel kernel);
+ScanKernel bestScanKernel();
+const char *scanKernelName(ScanKernel kernel);
+
+// Writes the offset of every structural byte in [data, data + size) to out, in order, and returns how many.
+// out must have room for size entries.
+size_t scanStructural(ScanKernel kernel, const char *data, size_t size, uint32_t *out);
+
+// Offsets of the structural bytes of a text, built in one pass so line parsers jump from
+// delimiter to delimiter instead of re-reading every byte.
+struct StructuralIndex {
+    const char *base;           // offsets are relative to this
+    const uint32_t *positions;
+    size_t count;
+
+    StructuralIndex() : base(nullptr), positions(nullptr), count(0) {}
+
+    // The entries array is placed in the arena
+    static StructuralIndex build(StrView text, FrameArena &arena);
+
+    // The entries that fall inside text, which must lie within the indexed buffer
+    StructuralIndex within(StrView text) const;
+};
+
+// Walks the lines of a text through its index
+class LineScanner {
+public:
+    LineScanner(StrView text, const StructuralIndex &index);
+
+    // Next line without its '\n' or trailing '\r', and the offset of its first ':' (npos if none).
+    // Returns false once the text is exhausted.
+    bool next(StrView &line, size_t &colon);
+
+    // Offset in the text of the first byte after the last line returned
+    size_t offset() const { return pos; }
+
+    // Number of '\n' in the text, from the index
+    size_t countLines() const;
+
+private:
+    StrView text;
+    const char *base;
+    const uint32_t *entry;
+    const uint32_t *end;
+    size_t pos;
+};
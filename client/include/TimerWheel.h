@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Hashed timer wheel: O(1) schedule and cancel, advance() costs one slot visit per elapsed tick.
+// Not thread safe, the owner is expected to hold its own lock around every call.
+class TimerWheel {
+public:
+    typedef std::function<void()> Callback;
+    typedef std::chrono::steady_clock Clock;
+
+    TimerWheel(int tickMs, size_t slotCount);
+
+    // Schedules callback to run delayMs from now (rounded up to a tick), however long the wheel has
+    // gone without advance(). Returns an ID for cancel().
+    unsigned long schedule(int delayMs, Callback callback);
+
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(unsigned long timerId);
+
+    // Moves the wheel to 'now' and returns the callbacks that became due, in firing order.
+    // They are returned rather than run so the caller can invoke them outside its lock.
+    std::vector<Callback> advance(Clock::time_point now);
+
+    // When the tick after the current one begins, for owners that sleep until the wheel has work
+    Clock::time_point nextTickAt() const { return start + std::chrono::milliseconds((currentTick + 1) * tickMs); }
+
+    size_t size() const { return index.size(); }
+    int getTickMs() const { return tickMs; }
+
+private:
+    struct Entry {
+        unsigned long id;
+        unsigned long rounds;   // full turns of the wheel left before the timer is due
+        Callback callback;
+
+        Entry(unsigned long id, unsigned long rounds, Callback callback) : id(id), rounds(rounds), callback(callback) {}
+    };
+
+    // Ticks from start to now
+    unsigned long tickAt(Clock::time_point now) const;
+
+    int tickMs;
+    std::vector<std::list<Entry>> slots;
+    std::unordered_map<unsigned long, std::pair<size_t, std::list<Entry>::iterator>> index;
+    Clock::time_point start;
+    unsigned long currentTick;
+    unsigned long nextId;
+};
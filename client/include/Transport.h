@@ -0,0 +1,89 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+#include "Connector.h"
+#include "SocketTuning.h"
+
+// Byte stream under ConnectionHandler. Errors come back through error_code like asio's own calls;
+// a read that waited timeoutMs without data fails with boost::asio::error::timed_out.
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    virtual void connect(boost::system::error_code &error) = 0;
+
+    // Uses an already connected socket instead of connecting. The transport owns fd afterwards.
+    virtual void attach(int fd, boost::system::error_code &error);
+
+    // Blocks until at least one byte arrives or timeoutMs passes (0 waits forever)
+    virtual size_t readSome(char *buffer, size_t size, int timeoutMs, boost::system::error_code &error) = 0;
+
+    // Writes first then second (which may be empty) as one gathered write
+    virtual void write(const char *first, size_t firstSize, const char *second, size_t secondSize,
+                       boost::system::error_code &error) = 0;
+
+    virtual void close() = 0;
+
+    // Socket options for the current and any later connection. Returns what the kernel refused.
+    // Transports that are not sockets ignore it.
+    virtual std::vector<std::string> tune(const SocketProfile &profile);
+
+    // Writes between cork(true) and cork(false) leave in full packets, when the profile corks batches
+    virtual void cork(bool on);
+
+    // Where it connects to, for messages
+    virtual std::string describe() const = 0;
+
+    // Transport for an address of the login command: host:port[,host:port...] or unix:{socket path}.
+    // nullptr if the address does not parse.
+    static std::unique_ptr<Transport> fromAddress(const std::string &address);
+};
+
+// Stream sockets through asio, TCP or Unix-domain
+template <typename Protocol>
+class SocketTransport : public Transport {
+public:
+    size_t readSome(char *buffer, size_t size, int timeoutMs, boost::system::error_code &error) override;
+    void write(const char *first, size_t firstSize, const char *second, size_t secondSize,
+               boost::system::error_code &error) override;
+    void close() override;
+    std::vector<std::string> tune(const SocketProfile &profile) override;
+    void cork(bool on) override;
+
+protected:
+    SocketTransport() : io_service_(), socket_(io_service_), profile_() {}
+
+    boost::asio::io_service io_service_;
+    typename Protocol::socket socket_;
+    SocketProfile profile_;
+};
+
+// Hosts may be names, and with several brokers the first to accept wins (see connectFirst)
+class TcpTransport : public SocketTransport<boost::asio::ip::tcp> {
+public:
+    TcpTransport(const std::string &host, short port);
+    explicit TcpTransport(const std::vector<BrokerEndpoint> &brokers);
+
+    void connect(boost::system::error_code &error) override;
+    void attach(int fd, boost::system::error_code &error) override;
+    std::string describe() const override;
+
+private:
+    std::vector<BrokerEndpoint> brokers_;
+};
+
+// Skips the TCP stack when the broker runs on the same host
+class UnixTransport : public SocketTransport<boost::asio::local::stream_protocol> {
+public:
+    explicit UnixTransport(const std::string &path);
+
+    void connect(boost::system::error_code &error) override;
+    void attach(int fd, boost::system::error_code &error) override;
+    std::string describe() const override;
+
+private:
+    std::string path_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#ifdef STOMP_IO_URING
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "Transport.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf;
+
+// TCP through io_uring, built with make IO_URING=1 and used for host:port when the kernel allows
+// it (Transport::fromAddress falls back to asio otherwise). Connecting is connectFirst's, as for
+// TcpTransport. Receiving is one multishot recv into a
+// ring of provided buffers: the kernel keeps filling buffers as data arrives, and every wait reaps
+// all the completions that piled up, so a busy subscriber crosses into the kernel once per batch
+// rather than once per read. Writes go out of a registered buffer with WRITE_FIXED.
+//
+// Like the socket transports, one thread reads and writers are serialized by the caller; reads and
+// writes use separate rings so neither has to lock.
+class UringTransport : public Transport {
+public:
+    explicit UringTransport(const std::vector<BrokerEndpoint> &brokers);
+    ~UringTransport();
+
+    UringTransport(const UringTransport &) = delete;
+    UringTransport &operator=(const UringTransport &) = delete;
+
+    void connect(boost::system::error_code &error) override;
+    void attach(int fd, boost::system::error_code &error) override;
+    size_t readSome(char *buffer, size_t size, int timeoutMs, boost::system::error_code &error) override;
+    void write(const char *first, size_t firstSize, const char *second, size_t secondSize,
+               boost::system::error_code &error) override;
+    void close() override;
+    std::vector<std::string> tune(const SocketProfile &profile) override;
+    void cork(bool on) override;
+    std::string describe() const override;
+
+    // Whether this kernel (and seccomp policy) provides what the transport needs
+    static bool supported();
+
+    static const unsigned RECV_BUFFERS = 64;
+    static const size_t RECV_BUFFER_BYTES = 16 * 1024;
+    static const size_t SEND_BUFFER_BYTES = 64 * 1024;
+
+private:
+    // One io_uring instance: submission and completion queues mapped from the kernel
+    struct Ring {
+        int fd;
+        void *sqMemory;
+        size_t sqBytes;
+        void *cqMemory;
+        size_t cqBytes;
+        io_uring_sqe *sqes;
+        size_t sqesBytes;
+        unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+        unsigned *cqHead, *cqTail, *cqMask;
+        io_uring_cqe *cqes;
+        unsigned toSubmit;
+
+        Ring();
+        bool open(unsigned entries);
+        void release();
+        io_uring_sqe *nextSqe();
+        // Submits queued entries and waits for at least waitFor completions. Returns -errno on failure.
+        int enter(unsigned waitFor, int timeoutMs);
+    };
+
+    // Bytes of a receive completion not handed to the caller yet
+    struct Received {
+        uint16_t bufferId;
+        uint32_t offset;
+        uint32_t length;
+
+        Received(uint16_t bufferId, uint32_t length) : bufferId(bufferId), offset(0), length(length) {}
+    };
+
+    bool setUp(boost::system::error_code &error);
+    void tearDown();
+    void armReceive();
+    void recycle(uint16_t bufferId);
+    // Moves every completion waiting in the receive ring to received_, noting the end of the stream
+    void reap();
+
+    std::vector<BrokerEndpoint> brokers_;
+    int socket_;
+    SocketProfile profile_;
+
+    Ring recvRing_;
+    Ring sendRing_;
+
+    // Provided buffer ring the kernel picks receive buffers from
+    io_uring_buf *bufferRing_;
+    size_t bufferRingBytes_;
+    std::vector<char> recvBuffers_;
+    uint16_t bufferTail_;
+    bool receiveArmed_;
+
+    std::deque<Received> received_;
+    int recvError_;             // 0, or the errno that ended the stream (-1 for end of file)
+
+    std::vector<char> sendBuffer_;
+};
+
+#endif
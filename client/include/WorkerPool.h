@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <condition_variable>
+
+// Fixed set of worker threads for fanning independent jobs (parsing files, writing summaries)
+// out over the cores. Threads are started on first use and kept for the next run.
+class WorkerPool {
+public:
+    typedef std::function<void(size_t index)> Task;
+
+    // 0 threads means one per core
+    explicit WorkerPool(size_t threads = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // Calls task(i) for every i in [0, count) across the workers and the calling thread,
+    // and returns once all calls have returned. task must not throw.
+    void run(size_t count, const Task &task);
+
+    size_t size() const { return threadCount; }
+
+private:
+    void start();
+    void workerLoop();
+    // Runs jobs of the current batch until none is left. Called with lock held, returns with it held.
+    void drain(std::unique_lock<std::mutex> &lock);
+
+    size_t threadCount;
+    std::vector<std::thread> threads;
+    std::mutex runMutex;                // one batch at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const Task *task;
+    size_t count;
+    size_t nextIndex;
+    size_t finished;
+    unsigned long batch;
+    bool stopping;
+};
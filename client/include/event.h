@@ -4,6 +4,9 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include "StrView.h"
+#include "FrameArena.h"
+#include "StructuralIndex.h"
 
 class Event
 {
@@ -39,6 +42,36 @@ public:
     const std::string &get_discription() const;
 };
 
+// One "key: value" line of a report body, tagged with the section it appeared in
+struct StatView {
+    enum Section { GENERAL, TEAM_A, TEAM_B };
+    Section section;
+    StrView key;
+    StrView value;
+};
+
+// Transient zero-copy parse of a report frame body. Fields point into the body, the stat array
+// lives in the arena, so nothing is allocated on the heap until toEvent() copies the event out.
+struct EventView {
+    StrView user;
+    StrView team_a_name;
+    StrView team_b_name;
+    StrView name;
+    int time;
+    StatView *stats;
+    size_t statCount;
+    StrView description;
+
+    EventView() : user(), team_a_name(), team_b_name(), name(), time(0), stats(nullptr), statCount(0), description() {}
+
+    static EventView parse(StrView body, FrameArena &arena);
+    // Reuses the index of the frame the body came from
+    static EventView parse(StrView body, const StructuralIndex &index, FrameArena &arena);
+
+    // Copies the event out, for the events that are retained
+    Event toEvent() const;
+};
+
 // an object that holds the names of the teams and a vector of events, to be returned by the parseEventsFile function
 struct names_and_events {
     std::string team_a_name;
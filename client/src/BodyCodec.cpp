@@ -0,0 +1,84 @@
+#include "../include/BodyCodec.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+const string BodyCodec::ENCODING_NAME = "x-wci-dict2";
+
+// Shared dictionary, trained on the sample event files by DictTrainer (make dictionary).
+// Both sides must use the same table, a retrained one goes out under a new ENCODING_NAME.
+// At most 95 entries, so every token index is a printable character.
+#include "../include/BodyDictionary.h"
+
+static const int DICTIONARY_SIZE = sizeof(DICTIONARY) / sizeof(DICTIONARY[0]);
+
+BodyCodec::BodyCodec() : byFirstByte(256), stats() {
+    for (int i = 0; i < DICTIONARY_SIZE; i++) {
+        byFirstByte[(unsigned char)DICTIONARY[i][0]].push_back(i);
+    }
+    for (auto &candidates : byFirstByte) {
+        stable_sort(candidates.begin(), candidates.end(), [](int a, int b) {
+            return char_traits<char>::length(DICTIONARY[a]) > char_traits<char>::length(DICTIONARY[b]);
+        });
+    }
+}
+
+string BodyCodec::encode(const string &body) {
+    auto start = chrono::steady_clock::now();
+
+    string out;
+    out.reserve(body.size());
+    size_t pos = 0;
+    while (pos < body.size()) {
+        int match = -1;
+        for (int idx : byFirstByte[(unsigned char)body[pos]]) {
+            // Candidates are sorted longest first, so the first hit is the best one
+            if (body.compare(pos, char_traits<char>::length(DICTIONARY[idx]), DICTIONARY[idx]) == 0) {
+                match = idx;
+                break;
+            }
+        }
+        if (match >= 0) {
+            out += ESCAPE;
+            out += (char)(0x20 + match);
+            pos += char_traits<char>::length(DICTIONARY[match]);
+        } else {
+            if (body[pos] == ESCAPE) out += ESCAPE;
+            out += body[pos];
+            pos++;
+        }
+    }
+
+    stats.framesEncoded++;
+    stats.bytesBefore += body.size();
+    stats.bytesAfter += out.size();
+    stats.encodeNanos += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    return out;
+}
+
+bool BodyCodec::decode(const string &encoded, string &out) {
+    auto start = chrono::steady_clock::now();
+
+    out.clear();
+    out.reserve(encoded.size() * 2);
+    for (size_t pos = 0; pos < encoded.size(); pos++) {
+        if (encoded[pos] != ESCAPE) {
+            out += encoded[pos];
+            continue;
+        }
+        if (++pos >= encoded.size()) return false;
+        char token = encoded[pos];
+        if (token == ESCAPE) {
+            out += ESCAPE;
+        } else {
+            int idx = (unsigned char)token - 0x20;
+            if (idx < 0 || idx >= DICTIONARY_SIZE) return false;
+            out += DICTIONARY[idx];
+        }
+    }
+
+    stats.framesDecoded++;
+    stats.decodeNanos += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    return true;
+}
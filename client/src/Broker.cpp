@@ -0,0 +1,734 @@
+#include "../include/Broker.h"
+#include "../include/StompFrame.h"
+#include "../include/TimerWheel.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+// Smallest heart-beat interval the broker guarantees to send at, in ms (as in the Java server)
+static const int SERVER_HEARTBEAT_MS = 1000;
+static const int TIMER_TICK_MS = 50;
+static const int MAX_EVENTS = 256;
+static const size_t READ_CHUNK = 64 * 1024;
+
+// epoll tokens that are not connection IDs
+static const uint64_t WAKE_TOKEN = ~0ULL;
+static const uint64_t LISTEN_TOKEN = ~0ULL - 1;
+
+struct BrokerConnection {
+    int fd;
+    int id;
+    BrokerReactor *owner;
+
+    // Owner thread only
+    string in;
+    bool loggedIn;
+    map<int, string> subscriptions;     // subscription ID -> channel
+    unsigned long heartbeatTimer;
+    bool closeAfterFlush;
+
+    // Any thread, under outMutex
+    mutex outMutex;
+    string out;
+    size_t outStart;        // bytes of out already written
+    bool queued;            // waiting in some reactor's flush list
+    bool writeArmed;        // EPOLLOUT is on
+    bool closed;
+
+    BrokerConnection(int fd, int id, BrokerReactor *owner)
+        : fd(fd), id(id), owner(owner), in(), loggedIn(false), subscriptions(), heartbeatTimer(0), closeAfterFlush(false),
+          outMutex(), out(), outStart(0), queued(false), writeArmed(false), closed(false) {}
+
+    BrokerConnection(const BrokerConnection &) = delete;
+    BrokerConnection &operator=(const BrokerConnection &) = delete;
+};
+
+typedef shared_ptr<BrokerConnection> ConnectionPtr;
+
+class BrokerReactor {
+public:
+    explicit BrokerReactor(Broker &broker);
+    ~BrokerReactor();
+
+    BrokerReactor(const BrokerReactor &) = delete;
+    BrokerReactor &operator=(const BrokerReactor &) = delete;
+
+    void start();
+    void stop();
+
+    // Any thread: hands a connected socket to this reactor
+    void add(int fd, int id);
+    void watchListener(int fd);
+
+    int getEpollFd() const { return epollFd; }
+
+private:
+    void loop();
+    void wake();
+    void drainPending();
+    void acceptAll();
+    void handleEvent(uint64_t token, uint32_t events);
+    void readFrom(const ConnectionPtr &connection);
+    void process(const ConnectionPtr &connection, StrView frame);
+
+    // Commands, as in StompMessagingProtocolImpl
+    void connect(const ConnectionPtr &connection, const FrameView &frame);
+    void send(const ConnectionPtr &connection, const FrameView &frame);
+    void subscribe(const ConnectionPtr &connection, const FrameView &frame);
+    void unsubscribe(const ConnectionPtr &connection, const FrameView &frame);
+    void acknowledge(const ConnectionPtr &connection, const FrameView &frame);
+    void disconnect(const ConnectionPtr &connection, const FrameView &frame);
+    void sendReceipt(const ConnectionPtr &connection, const string &receipt);
+    void sendError(const ConnectionPtr &connection, const string &message, const string &description, const string &receipt);
+
+    void startHeartbeat(const ConnectionPtr &connection, int intervalMs);
+    void scheduleHeartbeat(int id, int intervalMs);
+
+    // Queues bytes for a connection of any reactor; they are written when this reactor flushes
+    void deliver(const ConnectionPtr &connection, const string &head, const string &tail = string());
+    // Writes what the connection has queued. Returns true once its buffer is empty.
+    bool flush(const ConnectionPtr &connection);
+    void flushQueued();
+
+    // Drops the subscriptions and closes once everything queued is written, after ERROR or DISCONNECT
+    void finish(const ConnectionPtr &connection);
+    void close(const ConnectionPtr &connection);
+
+    Broker &broker;
+    int epollFd;
+    int wakeFd;
+    thread worker;
+    atomic<bool> running;
+
+    mutex pendingMutex;
+    vector<pair<int, int>> pending;     // fd, connection ID
+
+    unordered_map<int, ConnectionPtr> connections;
+    vector<ConnectionPtr> toFlush;
+    vector<ConnectionPtr> closing;
+    FrameArena arena;
+    TimerWheel timers;
+};
+
+// Header value trimmed like the Java server does; false if the header is missing
+static bool headerValue(const FrameView &frame, const char *name, string &value) {
+    const StrView *found = frame.header(name);
+    if (!found) return false;
+    size_t begin = 0, end = found->size;
+    while (begin < end && isspace(static_cast<unsigned char>(found->data[begin]))) begin++;
+    while (end > begin && isspace(static_cast<unsigned char>(found->data[end - 1]))) end--;
+    value.assign(found->data + begin, end - begin);
+    return true;
+}
+
+// Integer.parseInt: the whole string must be a number
+static bool parseInt(const string &text, int &value) {
+    if (text.empty()) return false;
+    char *end = nullptr;
+    errno = 0;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// How often to send heart-beats to a client that sent header, 0 if it did not ask for them
+static int negotiateHeartbeat(const FrameView &frame) {
+    string header;
+    if (!headerValue(frame, "heart-beat", header)) return 0;
+    size_t comma = header.find(',');
+    if (comma == string::npos || header.find(',', comma + 1) != string::npos) return 0;
+    string wants = header.substr(comma + 1);
+    wants.erase(0, wants.find_first_not_of(" \t"));
+    wants.erase(wants.find_last_not_of(" \t") + 1);
+    int clientWants;
+    if (!parseInt(wants, clientWants)) return 0;
+    return clientWants > 0 ? max(clientWants, SERVER_HEARTBEAT_MS) : 0;
+}
+
+// ---- Reactor ----
+
+BrokerReactor::BrokerReactor(Broker &broker)
+    : broker(broker), epollFd(epoll_create1(EPOLL_CLOEXEC)), wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), worker(),
+      running(false), pendingMutex(), pending(), connections(), toFlush(), closing(), arena(), timers(TIMER_TICK_MS, 512) {
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_TOKEN;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+}
+
+BrokerReactor::~BrokerReactor() {
+    stop();
+    for (auto &entry : connections) {
+        lock_guard<mutex> lock(entry.second->outMutex);
+        entry.second->closed = true;
+        ::close(entry.second->fd);
+    }
+    for (auto &fd : pending) ::close(fd.first);
+    ::close(wakeFd);
+    ::close(epollFd);
+}
+
+void BrokerReactor::start() {
+    running = true;
+    worker = thread(&BrokerReactor::loop, this);
+}
+
+void BrokerReactor::stop() {
+    if (!worker.joinable()) return;
+    running = false;
+    wake();
+    worker.join();
+}
+
+void BrokerReactor::wake() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+void BrokerReactor::add(int fd, int id) {
+    {
+        lock_guard<mutex> lock(pendingMutex);
+        pending.push_back(make_pair(fd, id));
+    }
+    wake();
+}
+
+void BrokerReactor::watchListener(int fd) {
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_TOKEN;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+void BrokerReactor::loop() {
+    epoll_event events[MAX_EVENTS];
+    while (running) {
+        int timeout = timers.size() > 0 ? TIMER_TICK_MS : -1;
+        int ready = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+        if (ready < 0 && errno != EINTR) {
+            cerr << "epoll_wait failed: " << strerror(errno) << endl;
+            return;
+        }
+        for (int i = 0; i < ready; i++) handleEvent(events[i].data.u64, events[i].events);
+
+        for (auto &callback : timers.advance(TimerWheel::Clock::now())) callback();
+        flushQueued();
+    }
+}
+
+void BrokerReactor::drainPending() {
+    uint64_t count;
+    ssize_t got = read(wakeFd, &count, sizeof(count));
+    (void)got;
+
+    vector<pair<int, int>> arrived;
+    {
+        lock_guard<mutex> lock(pendingMutex);
+        arrived.swap(pending);
+    }
+    for (auto &entry : arrived) {
+        ConnectionPtr connection = make_shared<BrokerConnection>(entry.first, entry.second, this);
+        connections[entry.second] = connection;
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = static_cast<uint64_t>(entry.second);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, entry.first, &event);
+    }
+}
+
+// Listeners share one token, a non-blocking accept on an idle one just returns
+void BrokerReactor::acceptAll() {
+    for (int listenFd : broker.listenFds) {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) break;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            broker.assign(fd);
+        }
+    }
+}
+
+void BrokerReactor::handleEvent(uint64_t token, uint32_t events) {
+    if (token == WAKE_TOKEN) {
+        drainPending();
+        return;
+    }
+    if (token == LISTEN_TOKEN) {
+        acceptAll();
+        return;
+    }
+    // The connection may have been closed by an earlier event of the same batch
+    auto found = connections.find(static_cast<int>(token));
+    if (found == connections.end()) return;
+    ConnectionPtr connection = found->second;
+
+    if (events & EPOLLOUT) {
+        if (flush(connection) && connection->closeAfterFlush) {
+            close(connection);
+            return;
+        }
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) readFrom(connection);
+}
+
+void BrokerReactor::readFrom(const ConnectionPtr &connection) {
+    char buffer[READ_CHUNK];
+    while (true) {
+        ssize_t got = recv(connection->fd, buffer, sizeof(buffer), 0);
+        if (got > 0) {
+            connection->in.append(buffer, got);
+            if (static_cast<size_t>(got) < sizeof(buffer)) break;
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (got < 0 && errno == EINTR) continue;
+        close(connection);
+        return;
+    }
+
+    string &in = connection->in;
+    size_t start = 0;
+    while (!connection->closeAfterFlush) {
+        // Heart-beats and stray line ends between frames
+        while (start < in.size() && (in[start] == '\n' || in[start] == '\r')) start++;
+        const char *end = static_cast<const char *>(memchr(in.data() + start, '\0', in.size() - start));
+        if (!end) break;
+        process(connection, StrView(in.data() + start, end - (in.data() + start)));
+        start = end - in.data() + 1;
+    }
+    in.erase(0, start);
+}
+
+void BrokerReactor::process(const ConnectionPtr &connection, StrView data) {
+    arena.reset();
+    FrameView frame;
+    if (!parseFrame(data, arena, frame)) return;
+    broker.framesIn++;
+
+    string command = frame.command.str();
+    command.erase(0, command.find_first_not_of(" \t"));
+    command.erase(command.find_last_not_of(" \t") + 1);
+
+    if (!connection->loggedIn && command != "CONNECT") {
+        sendError(connection, "User not logged in", "You must log in first.", "");
+        return;
+    }
+    if (command == "CONNECT") connect(connection, frame);
+    else if (command == "SEND") send(connection, frame);
+    else if (command == "SUBSCRIBE") subscribe(connection, frame);
+    else if (command == "UNSUBSCRIBE") unsubscribe(connection, frame);
+    else if (command == "DISCONNECT") disconnect(connection, frame);
+    else if (command == "ACK" || command == "NACK") acknowledge(connection, frame);
+    else cout << "Unknown command: " << command << endl;
+}
+
+void BrokerReactor::connect(const ConnectionPtr &connection, const FrameView &frame) {
+    string version, host, login, passcode;
+    if (!headerValue(frame, "accept-version", version) || version.find("1.2") == string::npos ||
+        !headerValue(frame, "host", host) || !headerValue(frame, "login", login) || !headerValue(frame, "passcode", passcode)) {
+        sendError(connection, "Malformed Frame", "Invalid CONNECT frame parameters", "");
+        return;
+    }
+
+    switch (broker.login(connection->id, login, passcode)) {
+        case Broker::ADDED_NEW_USER:
+        case Broker::LOGGED_IN_SUCCESSFULLY: {
+            connection->loggedIn = true;
+            int interval = negotiateHeartbeat(frame);
+            deliver(connection, "CONNECTED\nversion:1.2\nheart-beat:" + to_string(interval > 0 ? SERVER_HEARTBEAT_MS : 0) + ",0\n" + '\0');
+            startHeartbeat(connection, interval);
+            break;
+        }
+        case Broker::WRONG_PASSWORD:
+            sendError(connection, "Wrong password", "Password does not match", "");
+            break;
+        case Broker::ALREADY_LOGGED_IN:
+            sendError(connection, "User already logged in", "User is already logged in", "");
+            break;
+        case Broker::CLIENT_ALREADY_CONNECTED:
+            break;
+    }
+}
+
+void BrokerReactor::send(const ConnectionPtr &connection, const FrameView &frame) {
+    string destination, receipt, encoding;
+    headerValue(frame, "receipt", receipt);
+    if (!headerValue(frame, "destination", destination)) {
+        sendError(connection, "Malformed Frame", "Missing destination or body", receipt);
+        return;
+    }
+
+    bool subscribed = false;
+    for (auto const &subscription : connection->subscriptions) subscribed = subscribed || subscription.second == destination;
+    shared_ptr<const Broker::SubscriberList> targets = broker.subscribers(destination);
+    if (!subscribed || !targets) {
+        sendError(connection, "Not subscribed", "User is not subscribed to topic " + destination, receipt);
+        return;
+    }
+
+    // The Java server rebuilds the body from its lines, which drops trailing line ends
+    StrView body = frame.body;
+    while (body.size > 0 && body.data[body.size - 1] == '\n') body.size--;
+
+    long messageId = ++broker.nextMessageId;
+    string id = to_string(messageId);
+    string tail = "destination:" + destination + "\n";
+    if (headerValue(frame, "content-encoding", encoding)) tail += "content-encoding:" + encoding + "\n";
+    tail += "\n";
+    tail.append(body.data, body.size);
+    tail += '\0';
+
+    for (auto const &target : *targets) {
+        string head = "MESSAGE\nsubscription:" + to_string(target.subscriptionId) + "\nmessage-id:" + id + "\n";
+        if (target.needsAck) head += "ack:" + id + "\n";
+        deliver(target.connection, head, tail);
+    }
+    broker.messagesOut += targets->size();
+    sendReceipt(connection, receipt);
+}
+
+void BrokerReactor::subscribe(const ConnectionPtr &connection, const FrameView &frame) {
+    string destination, id, receipt, ackMode;
+    headerValue(frame, "receipt", receipt);
+    bool hasAck = headerValue(frame, "ack", ackMode);
+    if (hasAck && ackMode != "auto" && ackMode != "client" && ackMode != "client-individual") {
+        sendError(connection, "Malformed Frame", "Unknown ack mode " + ackMode, receipt);
+        return;
+    }
+    if (!headerValue(frame, "destination", destination) || !headerValue(frame, "id", id)) {
+        sendError(connection, "Malformed Frame", "Missing destination or id header", receipt);
+        return;
+    }
+    int subscriptionId;
+    if (!parseInt(id, subscriptionId)) {
+        sendError(connection, "Invalid ID", "Subscription ID must be a number", receipt);
+        return;
+    }
+
+    // A reused subscription ID moves to the new channel
+    auto previous = connection->subscriptions.find(subscriptionId);
+    if (previous != connection->subscriptions.end()) broker.unsubscribe(*connection, previous->second);
+    connection->subscriptions[subscriptionId] = destination;
+    broker.subscribe(connection, destination, subscriptionId, hasAck && ackMode != "auto");
+    sendReceipt(connection, receipt);
+}
+
+void BrokerReactor::unsubscribe(const ConnectionPtr &connection, const FrameView &frame) {
+    string id, receipt;
+    headerValue(frame, "receipt", receipt);
+    if (!headerValue(frame, "id", id)) {
+        sendError(connection, "Malformed Frame", "Missing id header", receipt);
+        return;
+    }
+    int subscriptionId;
+    if (!parseInt(id, subscriptionId)) {
+        sendError(connection, "Invalid ID", "Subscription ID must be a number", receipt);
+        return;
+    }
+    auto found = connection->subscriptions.find(subscriptionId);
+    if (found != connection->subscriptions.end()) {
+        broker.unsubscribe(*connection, found->second);
+        connection->subscriptions.erase(found);
+    }
+    sendReceipt(connection, receipt);
+}
+
+// Messages are not kept for redelivery, so an ACK or NACK only needs a well formed id and its receipt
+void BrokerReactor::acknowledge(const ConnectionPtr &connection, const FrameView &frame) {
+    string id, receipt;
+    headerValue(frame, "receipt", receipt);
+    if (!headerValue(frame, "id", id)) {
+        sendError(connection, "Malformed Frame", "Missing id header", receipt);
+        return;
+    }
+    sendReceipt(connection, receipt);
+}
+
+void BrokerReactor::disconnect(const ConnectionPtr &connection, const FrameView &frame) {
+    string receipt;
+    headerValue(frame, "receipt", receipt);
+    broker.logout(connection->id);
+    connection->loggedIn = false;
+    sendReceipt(connection, receipt);
+    finish(connection);
+}
+
+void BrokerReactor::sendReceipt(const ConnectionPtr &connection, const string &receipt) {
+    if (receipt.empty()) return;
+    deliver(connection, "RECEIPT\nreceipt-id:" + receipt + "\n" + '\0');
+}
+
+void BrokerReactor::sendError(const ConnectionPtr &connection, const string &message, const string &description, const string &receipt) {
+    string frame = "ERROR\n";
+    if (!receipt.empty()) frame += "receipt-id:" + receipt + "\n";
+    frame += "message:" + message + "\n\n" + description + '\0';
+    deliver(connection, frame);
+    finish(connection);
+}
+
+void BrokerReactor::startHeartbeat(const ConnectionPtr &connection, int intervalMs) {
+    if (intervalMs <= 0) return;
+    scheduleHeartbeat(connection->id, intervalMs);
+}
+
+void BrokerReactor::scheduleHeartbeat(int id, int intervalMs) {
+    auto found = connections.find(id);
+    if (found == connections.end()) return;
+    found->second->heartbeatTimer = timers.schedule(intervalMs, [this, id, intervalMs]() {
+        auto connection = connections.find(id);
+        if (connection == connections.end() || connection->second->closeAfterFlush) return;
+        deliver(connection->second, "\n");
+        scheduleHeartbeat(id, intervalMs);
+    });
+}
+
+void BrokerReactor::deliver(const ConnectionPtr &connection, const string &head, const string &tail) {
+    lock_guard<mutex> lock(connection->outMutex);
+    if (connection->closed) return;
+    connection->out += head;
+    connection->out += tail;
+    if (!connection->queued) {
+        connection->queued = true;
+        toFlush.push_back(connection);
+    }
+}
+
+bool BrokerReactor::flush(const ConnectionPtr &connection) {
+    lock_guard<mutex> lock(connection->outMutex);
+    connection->queued = false;
+    if (connection->closed) return true;
+
+    string &out = connection->out;
+    while (connection->outStart < out.size()) {
+        ssize_t sent = ::send(connection->fd, out.data() + connection->outStart, out.size() - connection->outStart, MSG_NOSIGNAL);
+        if (sent > 0) {
+            connection->outStart += sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Wait for the socket to drain; the owner reactor gets EPOLLOUT and flushes the rest
+            if (!connection->writeArmed) {
+                epoll_event event;
+                event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+                event.data.u64 = static_cast<uint64_t>(connection->id);
+                epoll_ctl(connection->owner->getEpollFd(), EPOLL_CTL_MOD, connection->fd, &event);
+                connection->writeArmed = true;
+            }
+            return false;
+        }
+        // Broken connection: drop the output, the owner sees the hang-up and closes it
+        break;
+    }
+    out.clear();
+    connection->outStart = 0;
+    if (connection->writeArmed) {
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = static_cast<uint64_t>(connection->id);
+        epoll_ctl(connection->owner->getEpollFd(), EPOLL_CTL_MOD, connection->fd, &event);
+        connection->writeArmed = false;
+    }
+    return true;
+}
+
+void BrokerReactor::flushQueued() {
+    vector<ConnectionPtr> batch;
+    batch.swap(toFlush);
+    for (auto &connection : batch) flush(connection);
+
+    vector<ConnectionPtr> waiting;
+    waiting.swap(closing);
+    for (auto &connection : waiting) {
+        if (flush(connection)) close(connection);
+    }
+}
+
+void BrokerReactor::finish(const ConnectionPtr &connection) {
+    if (connection->closeAfterFlush) return;
+    connection->closeAfterFlush = true;
+    timers.cancel(connection->heartbeatTimer);
+    for (auto const &subscription : connection->subscriptions) broker.unsubscribe(*connection, subscription.second);
+    connection->subscriptions.clear();
+    closing.push_back(connection);
+}
+
+void BrokerReactor::close(const ConnectionPtr &connection) {
+    if (!connections.count(connection->id)) return;
+    timers.cancel(connection->heartbeatTimer);
+    for (auto const &subscription : connection->subscriptions) broker.unsubscribe(*connection, subscription.second);
+    connection->subscriptions.clear();
+    broker.logout(connection->id);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, nullptr);
+    {
+        lock_guard<mutex> lock(connection->outMutex);
+        connection->closed = true;
+        ::close(connection->fd);
+    }
+    connections.erase(connection->id);
+}
+
+// ---- Broker ----
+
+Broker::Broker(size_t threads)
+    : threadCount(threads > 0 ? threads : max(1u, thread::hardware_concurrency())), reactors(), listenFds(), unixPaths(),
+      nextConnectionId(0), nextReactor(0), nextMessageId(0), usersMutex(), users(), connectionUsers(),
+      channelsMutex(), channels(), connectionCount(0), framesIn(0), messagesOut(0) {
+    for (size_t i = 0; i < threadCount; i++) reactors.push_back(unique_ptr<BrokerReactor>(new BrokerReactor(*this)));
+}
+
+Broker::~Broker() {
+    stop();
+    reactors.clear();
+    for (int listenFd : listenFds) ::close(listenFd);
+    for (auto const &path : unixPaths) unlink(path.c_str());
+}
+
+bool Broker::listen(unsigned short port) {
+    int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        cerr << "socket failed: " << strerror(errno) << endl;
+        return false;
+    }
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+        cerr << "Cannot listen on port " << port << ": " << strerror(errno) << endl;
+        ::close(listenFd);
+        return false;
+    }
+    listenFds.push_back(listenFd);
+    reactors[0]->watchListener(listenFd);
+    return true;
+}
+
+bool Broker::listenUnix(const string &path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path too long: " << path << endl;
+        return false;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        cerr << "socket failed: " << strerror(errno) << endl;
+        return false;
+    }
+    // A socket file left behind by an earlier run would fail the bind
+    unlink(path.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+        cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+        ::close(listenFd);
+        return false;
+    }
+    listenFds.push_back(listenFd);
+    unixPaths.push_back(path);
+    reactors[0]->watchListener(listenFd);
+    return true;
+}
+
+void Broker::adopt(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    assign(fd);
+}
+
+void Broker::assign(int fd) {
+    connectionCount++;
+    reactors[nextReactor++ % reactors.size()]->add(fd, nextConnectionId++);
+}
+
+void Broker::start() {
+    for (auto &reactor : reactors) reactor->start();
+}
+
+void Broker::stop() {
+    for (auto &reactor : reactors) reactor->stop();
+}
+
+BrokerStats Broker::stats() const {
+    BrokerStats s;
+    s.connections = connectionCount;
+    s.framesIn = framesIn;
+    s.messagesOut = messagesOut;
+    return s;
+}
+
+Broker::LoginStatus Broker::login(int connectionId, const string &user, const string &password) {
+    lock_guard<mutex> lock(usersMutex);
+    if (connectionUsers.count(connectionId)) return CLIENT_ALREADY_CONNECTED;
+    auto found = users.find(user);
+    if (found == users.end()) {
+        users[user].password = password;
+        users[user].connectionId = connectionId;
+        connectionUsers[connectionId] = user;
+        return ADDED_NEW_USER;
+    }
+    if (found->second.connectionId >= 0) return ALREADY_LOGGED_IN;
+    if (found->second.password != password) return WRONG_PASSWORD;
+    found->second.connectionId = connectionId;
+    connectionUsers[connectionId] = user;
+    return LOGGED_IN_SUCCESSFULLY;
+}
+
+void Broker::logout(int connectionId) {
+    lock_guard<mutex> lock(usersMutex);
+    auto found = connectionUsers.find(connectionId);
+    if (found == connectionUsers.end()) return;
+    users[found->second].connectionId = -1;
+    connectionUsers.erase(found);
+}
+
+void Broker::subscribe(const shared_ptr<BrokerConnection> &connection, const string &channel, int subscriptionId, bool needsAck) {
+    lock_guard<mutex> lock(channelsMutex);
+    shared_ptr<SubscriberList> updated = make_shared<SubscriberList>();
+    auto found = channels.find(channel);
+    if (found != channels.end()) {
+        // One subscription per connection and channel, a second one replaces the first
+        for (auto const &subscriber : *found->second) {
+            if (subscriber.connection != connection) updated->push_back(subscriber);
+        }
+    }
+    updated->push_back(Subscriber(connection, subscriptionId, needsAck));
+    channels[channel] = updated;
+}
+
+void Broker::unsubscribe(const BrokerConnection &connection, const string &channel) {
+    lock_guard<mutex> lock(channelsMutex);
+    auto found = channels.find(channel);
+    if (found == channels.end()) return;
+    shared_ptr<SubscriberList> updated = make_shared<SubscriberList>();
+    for (auto const &subscriber : *found->second) {
+        if (subscriber.connection.get() != &connection) updated->push_back(subscriber);
+    }
+    if (updated->empty()) channels.erase(found);
+    else found->second = updated;
+}
+
+shared_ptr<const Broker::SubscriberList> Broker::subscribers(const string &channel) const {
+    lock_guard<mutex> lock(channelsMutex);
+    auto found = channels.find(channel);
+    return found == channels.end() ? shared_ptr<const SubscriberList>() : found->second;
+}
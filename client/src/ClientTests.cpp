@@ -0,0 +1,541 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/Connector.h"
+#include "../include/DedupWindow.h"
+#include "../include/EventLoader.h"
+#include "../include/FrameArena.h"
+#include "../include/FrameCapture.h"
+#include "../include/FramePacer.h"
+#include "../include/ReceiptManager.h"
+#include "../include/StompFrame.h"
+#include "../include/StructuralIndex.h"
+#include "../include/TimerWheel.h"
+#include "../include/json.hpp"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using Clock = TimerWheel::Clock;
+
+// Behaviour tests for the client's building blocks (make test). Each check prints one line; the exit
+// status is the number of failed checks.
+
+static int failures = 0;
+
+static void check(bool ok, const string &what) {
+    cout << (ok ? "ok      " : "FAILED  ") << what << endl;
+    if (!ok) failures++;
+}
+
+static void idle(int ms) {
+    this_thread::sleep_for(chrono::milliseconds(ms));
+}
+
+static string readFile(const string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// The owner of a wheel stops calling advance() while it is empty; a timer scheduled afterwards
+// must still count its delay from the moment it was scheduled
+static void testWheelScheduleAfterIdle() {
+    TimerWheel wheel(1, 64);
+    idle(50);
+    Clock::time_point scheduled = Clock::now();
+    wheel.schedule(20, []() {});
+    check(wheel.advance(scheduled + chrono::milliseconds(5)).empty(), "wheel: timer scheduled after idling is not due at once");
+    check(wheel.advance(scheduled + chrono::milliseconds(25)).size() == 1, "wheel: timer scheduled after idling fires after its delay");
+}
+
+// Delays longer than a turn of the wheel, counted from a stale tick, come out a turn short
+static void testWheelLongDelayAfterIdle() {
+    TimerWheel wheel(1, 8);
+    idle(30);
+    Clock::time_point scheduled = Clock::now();
+    wheel.schedule(20, []() {});
+    check(wheel.advance(scheduled + chrono::milliseconds(15)).empty(), "wheel: delay longer than a turn is not cut short after idling");
+    check(wheel.advance(scheduled + chrono::milliseconds(25)).size() == 1, "wheel: delay longer than a turn fires after idling");
+}
+
+// Login, a quiet spell longer than the receipt timeout, then a join: the join's receipt must get its full timeout
+static void testReceiptAfterIdle() {
+    ReceiptManager receipts(10);
+    string action;
+    receipts.expect(0, "login", 100);
+    receipts.complete(0, action);
+    idle(300);
+    shared_future<bool> joined = receipts.expect(1, "join", 100);
+    idle(30);
+    check(receipts.isPending(1), "receipts: receipt expected after idling does not time out at once");
+    receipts.complete(1, action);
+    check(joined.get(), "receipts: receipt expected after idling is confirmed");
+}
+
+// A paced replay spanning several receipt timeouts: each receipt is armed when its frame is written,
+// on a wheel that sat idle since the last one, and must live until the server answers
+static void testReplayLongerThanTimeout() {
+    const int timeoutMs = 100;
+    const int frames = 4;
+    ReceiptManager receipts(10);
+    vector<shared_future<bool>> confirmed;
+    vector<OutgoingFrame> paced;
+    for (int i = 0; i < frames; i++) {
+        confirmed.push_back(receipts.expect(i, "report " + to_string(i), timeoutMs, ReceiptManager::Callback(), false));
+        paced.push_back(OutgoingFrame("SEND", i));
+        paced.back().sendAfterMs = i * 2 * timeoutMs;
+    }
+
+    atomic<int> sent(0);
+    atomic<int> answered(0);
+    FramePacer pacer([&](const OutgoingFrame &frame) {
+        receipts.restart(frame.receiptId);
+        // The server takes a moment to answer; the last frame is still being written when the wheel empties
+        idle(20);
+        string action;
+        if (receipts.complete(frame.receiptId, action)) answered++;
+        sent++;
+        return true;
+    });
+    pacer.schedule(paced);
+    pacer.waitIdle();
+    check(answered == frames, "replay: receipts armed after idling wait for their answer");
+    bool all = true;
+    for (auto &future : confirmed) all = all && future.get();
+    check(all, "replay: every paced receipt is confirmed");
+}
+
+// Frames go out by sendAfterMs, never early, those due together in the order they were scheduled
+static void testPacerOrder() {
+    const int delays[] = {60, 0, 30, 30, 10, -1, 30};
+    vector<OutgoingFrame> frames;
+    for (size_t i = 0; i < sizeof(delays) / sizeof(delays[0]); i++) {
+        frames.push_back(OutgoingFrame("frame " + to_string(i)));
+        frames.back().sendAfterMs = delays[i];
+    }
+
+    std::mutex sentMutex;
+    vector<pair<string, double>> sent;
+    Clock::time_point start = Clock::now();
+    FramePacer pacer([&](const OutgoingFrame &frame) {
+        lock_guard<std::mutex> lock(sentMutex);
+        sent.push_back(make_pair(frame.frame, chrono::duration<double, milli>(Clock::now() - start).count()));
+        return true;
+    });
+    pacer.schedule(frames);
+    pacer.waitIdle();
+
+    vector<string> order;
+    bool early = false;
+    for (auto const &item : sent) {
+        order.push_back(item.first);
+        size_t index = stoul(item.first.substr(6));
+        early = early || item.second < max(delays[index], 0);
+    }
+    check(order == vector<string>({"frame 1", "frame 5", "frame 4", "frame 2", "frame 3", "frame 6", "frame 0"}),
+          "pacer: frames go out by delay, ties in scheduling order");
+    check(!early, "pacer: no frame goes out before its delay");
+
+    // What is still waiting when the replay is cancelled is handed back and never sent
+    sent.clear();
+    pacer.schedule(frames);
+    idle(45);
+    vector<OutgoingFrame> cancelled = pacer.cancelAll();
+    idle(40);
+    check(cancelled.size() == 1 && cancelled[0].frame == "frame 0" && sent.size() == 6 && pacer.pending() == 0,
+          "pacer: cancelAll returns the frames still waiting and they are not sent");
+}
+
+// Logout while the last frame is being written: the frame is off the wheel but not out yet
+static void testPacerIdleWaitsForWrite() {
+    atomic<int> sent(0);
+    FramePacer pacer([&](const OutgoingFrame &) {
+        idle(50);
+        sent++;
+        return true;
+    });
+    pacer.schedule(vector<OutgoingFrame>(1, OutgoingFrame("SEND")));
+    idle(20);
+    check(pacer.pending() == 1, "pacer: a frame being written is still pending");
+    pacer.waitIdle();
+    check(sent == 1, "pacer: waitIdle returns only once the frame being written is out");
+}
+
+// Frames written by the capture come back in order with their timing; a capture cut short mid-record
+// (the client crashed while writing) yields every complete frame and then ends
+static void testCaptureTruncated() {
+    const string path = "bin/truncated.cap";
+    FrameCaptureWriter writer;
+    check(writer.start(path), "capture: a capture file is created");
+    const string frames[] = {"CONNECTED\nversion:1.2\n\n", "MESSAGE\ndestination:/a\n\nfirst", "MESSAGE\ndestination:/a\n\nsecond"};
+    for (const string &frame : frames) {
+        writer.record(frame);
+        idle(2);
+    }
+    check(writer.stop() == 3, "capture: stop counts the frames captured");
+    writer.record("after stop");
+
+    FrameCaptureReader reader;
+    string error;
+    CapturedFrame frame;
+    bool inOrder = reader.open(path, error);
+    uint64_t lastOffset = 0;
+    for (size_t i = 0; i < 3 && inOrder; i++) {
+        inOrder = reader.next(frame) && frame.frame == frames[i] && (i == 0 || frame.offsetNs >= lastOffset + 1000000);
+        lastOffset = frame.offsetNs;
+    }
+    check(inOrder && !reader.next(frame), "capture: frames come back in order with their spacing, nothing after stop");
+
+    // Cut the file one byte into the last frame's bytes, then inside its length
+    string whole = readFile(path);
+    for (size_t cut : {whole.size() - frames[2].size() + 1, whole.size() - frames[2].size() - 1}) {
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(whole.data(), static_cast<std::streamsize>(cut));
+        }
+        FrameCaptureReader truncated;
+        size_t complete = 0;
+        if (truncated.open(path, error)) {
+            while (truncated.next(frame)) complete++;
+        }
+        check(complete == 2, "capture: a capture cut at byte " + to_string(cut) + " of " + to_string(whole.size()) +
+                             " yields its complete frames");
+    }
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(whole.data(), 10);
+    }
+    FrameCaptureReader headerOnly;
+    check(!headerOnly.open(path, error) && !error.empty(), "capture: a file cut inside the header is not a capture");
+    remove(path.c_str());
+}
+
+// A record whose length runs past the end of the file ends the capture rather than sizing a buffer by it
+static void testCaptureRejectsCorruptLength() {
+    const string path = "bin/corrupt.cap";
+    FrameCaptureWriter writer;
+    writer.start(path);
+    writer.record("MESSAGE\n\nhello");
+    writer.stop();
+    {
+        std::ofstream corrupt(path, std::ios::binary | std::ios::app);
+        // Delta 0, then a length of 2^56 in varint form, then a few bytes
+        const char record[] = {0, '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', '\x80', 1, 'x', 'y'};
+        corrupt.write(record, sizeof(record));
+    }
+
+    FrameCaptureReader reader;
+    string error;
+    CapturedFrame frame;
+    bool opened = reader.open(path, error);
+    check(opened && reader.next(frame) && frame.frame == "MESSAGE\n\nhello", "capture: frames before a corrupt record are read");
+    bool rejected = false;
+    try {
+        rejected = !reader.next(frame);
+    } catch (...) {
+    }
+    check(rejected, "capture: a length past the end of the file is rejected");
+    remove(path.c_str());
+}
+
+// Message IDs: a repeat inside the window is a duplicate, IDs older than the window count as new
+static void testDedupIds() {
+    DedupWindow window(64, 16);
+    check(!window.seenId(5) && window.seenId(5), "dedup: a repeated message ID is a duplicate");
+    check(!window.seenId(3) && window.seenId(3), "dedup: an ID below the highest one is remembered too");
+    check(!window.seenId(200), "dedup: an ID far ahead slides the window");
+    check(!window.seenId(100), "dedup: an ID older than the window is reported as new");
+    check(!window.seenId(199) && window.seenId(200), "dedup: IDs skipped while sliding are new, the highest is not");
+    window.resetIds();
+    check(!window.seenId(200), "dedup: resetIds forgets every ID");
+    check(!window.seenId(-1) && !window.seenId(-1), "dedup: a missing ID is never a duplicate");
+}
+
+// Event hashes: remembered for at least hashCapacity events, forgotten after two generations
+static void testDedupHashes() {
+    uint64_t kickoff = DedupWindow::hashEvent(StrView("a", 1), StrView("Germany_Japan", 13), 0, StrView("kickoff", 7));
+    check(kickoff == DedupWindow::hashEvent(StrView("a", 1), StrView("Germany_Japan", 13), 0, StrView("kickoff", 7)),
+          "dedup: the same event hashes the same");
+    check(DedupWindow::hashEvent(StrView("ab", 2), StrView("c", 1), 0, StrView("x", 1)) !=
+          DedupWindow::hashEvent(StrView("a", 1), StrView("bc", 2), 0, StrView("x", 1)),
+          "dedup: fields are hashed apart");
+
+    const size_t capacity = 16;
+    DedupWindow window(64, capacity);
+    check(!window.seenHash(kickoff) && window.seenHash(kickoff), "dedup: a repeated event is a duplicate");
+    for (uint64_t hash = 1000; hash < 1000 + capacity; hash++) window.seenHash(hash);
+    check(window.seenHash(kickoff), "dedup: an event is remembered for hashCapacity more events");
+    for (uint64_t hash = 2000; hash < 2000 + 2 * capacity; hash++) window.seenHash(hash);
+    check(!window.seenHash(kickoff), "dedup: an event is forgotten after two generations");
+    check(!window.seenHash(0) && window.seenHash(0), "dedup: a zero hash is remembered like any other");
+}
+
+// Allocations are aligned, and reset() reuses the chunks instead of asking the heap again
+static void testFrameArena() {
+    FrameArena arena(256);
+    arena.allocate(1, 1);
+    void *aligned = arena.allocate(24, 16);
+    check(reinterpret_cast<uintptr_t>(aligned) % 16 == 0, "arena: allocations honour their alignment");
+    char *big = static_cast<char *>(arena.allocate(1000, 1));
+    big[999] = 'x';
+    check(arena.bytesUsed() == 1025 && arena.capacity() >= 1256, "arena: a block larger than a chunk gets a chunk of its own");
+
+    size_t capacity = arena.capacity();
+    for (int frame = 0; frame < 100; frame++) {
+        arena.reset();
+        arena.allocate(24, 16);
+        arena.allocate(1000, 1);
+    }
+    check(arena.bytesUsed() == 1024 && arena.capacity() == capacity, "arena: frames after a reset reuse the same chunks");
+}
+
+// Command, headers and body of a frame, all pointing into the frame text
+static void testParseFrame() {
+    FrameArena arena;
+    FrameView frame;
+    string text = "MESSAGE\nsubscription:7\ndestination:/Germany_Japan\nmessage-id:42\n\nbody line\nsecond: line";
+    check(parseFrame(text, arena, frame) && frame.command.equals("MESSAGE") && frame.headerCount == 3,
+          "frame: command and headers are split");
+    check(frame.headerOr("destination", "") == "/Germany_Japan" && frame.headerOr("receipt", "none") == "none",
+          "frame: headers are found by name, with a fallback");
+    check(frame.body.str() == "body line\nsecond: line" && frame.body.data == text.data() + text.find("body"),
+          "frame: the body is a view into the frame");
+
+    arena.reset();
+    const char withNul[] = "RECEIPT\nreceipt-id:1\nreceipt-id:2\n\nkept\0dropped";
+    string repeated(withNul, sizeof(withNul) - 1);
+    check(parseFrame(repeated, arena, frame) && frame.headerOr("receipt-id", "") == "2", "frame: a repeated header resolves to its last value");
+    check(frame.body.str() == "kept", "frame: the body ends at the first NUL");
+
+    arena.reset();
+    check(parseFrame(string("CONNECTED\r\nversion:1.2\r\n"), arena, frame) && frame.command.equals("CONNECTED") &&
+          frame.headerOr("version", "") == "1.2" && frame.body.empty(), "frame: CRLF lines and a missing blank line are accepted");
+    arena.reset();
+    check(!parseFrame(string("\nversion:1.2\n\n"), arena, frame), "frame: a frame without a command is rejected");
+}
+
+// A report body as StompProtocol sends it, parsed without copying
+static void testParseEvent() {
+    FrameArena arena;
+    string body = "user: a\nteam a: Germany\nteam b: Japan\nevent name: goal!!!!\ntime: 1980\n"
+                  "general game updates:\nactive: true\nteam a updates:\ngoals: 1\npossession: 51%\n"
+                  "team b updates:\ndescription:\nA goal.\nWhat a shot: top corner.";
+    EventView view = EventView::parse(StrView(body), arena);
+    check(view.user.equals("a") && view.team_a_name.equals("Germany") && view.team_b_name.equals("Japan") &&
+          view.name.equals("goal!!!!") && view.time == 1980, "event: header fields are read");
+    check(view.statCount == 3 && view.stats[0].section == StatView::GENERAL && view.stats[2].section == StatView::TEAM_A &&
+          view.stats[2].key.equals("possession") && view.stats[2].value.equals("51%"), "event: stats are read with their section");
+    check(view.description.equals("A goal.\nWhat a shot: top corner."), "event: the description runs to the end, colons included");
+
+    Event event = view.toEvent();
+    check(event.get_team_a_updates().at("goals") == "1" && event.get_team_b_updates().empty() &&
+          event.get_discription() == "A goal.\nWhat a shot: top corner.\n", "event: toEvent copies the event out");
+}
+
+// Every kernel finds the same delimiters as a byte by byte loop, at every length and alignment
+static void testScanKernels() {
+    // Pseudo-random text, dense in delimiters and with bytes above 0x7f, the same on every run
+    string text(1024 + 64, 'a');
+    const char alphabet[] = {'\n', ':', '\0', 'x', 'y', ' ', '\r', '\x80', '\xff', '\x3a' + 1, '\x09'};
+    uint32_t seed = 12345;
+    for (char &c : text) {
+        seed = seed * 1103515245 + 12345;
+        c = alphabet[(seed >> 16) % sizeof(alphabet)];
+    }
+
+    vector<uint32_t> expected, found(text.size());
+    for (ScanKernel kernel : {ScanKernel::SCALAR, ScanKernel::SSE2, ScanKernel::AVX2}) {
+        if (!scanKernelSupported(kernel)) {
+            cout << "skipped " << scanKernelName(kernel) << " kernel, not supported here" << endl;
+            continue;
+        }
+        bool agrees = true;
+        for (size_t start = 0; start < 64 && agrees; start++) {
+            for (size_t size = 0; start + size <= text.size() && agrees; size += (size < 100 ? 1 : 37)) {
+                expected.clear();
+                for (size_t i = 0; i < size; i++) {
+                    char c = text[start + i];
+                    if (c == '\n' || c == ':' || c == '\0') expected.push_back(static_cast<uint32_t>(i));
+                }
+                size_t count = scanStructural(kernel, text.data() + start, size, found.data());
+                agrees = count == expected.size() && equal(expected.begin(), expected.end(), found.begin());
+            }
+        }
+        check(agrees, string("scan: ") + scanKernelName(kernel) + " finds every delimiter at any length and alignment");
+    }
+}
+
+// The index drives line scanning: lines, colons and sub-ranges come out as a plain reading gives them
+static void testStructuralIndex() {
+    FrameArena arena;
+    string text = "first: line\r\nno colon\n\nlast:one:two";
+    StructuralIndex index = StructuralIndex::build(StrView(text), arena);
+    LineScanner lines(StrView(text), index);
+    StrView line;
+    size_t colon;
+    vector<string> seen;
+    vector<size_t> colons;
+    while (lines.next(line, colon)) {
+        seen.push_back(line.str());
+        colons.push_back(colon);
+    }
+    check(seen == vector<string>({"first: line", "no colon", "", "last:one:two"}), "index: lines come out without their line ends");
+    check(colons == vector<size_t>({5, string::npos, string::npos, 4}), "index: each line reports its first colon");
+    check(LineScanner(StrView(text), index).countLines() == 3, "index: lines are counted from the index");
+
+    StrView tail = StrView(text).substr(text.find("last"));
+    StructuralIndex inTail = index.within(tail);
+    check(inTail.count == 2 && inTail.base[inTail.positions[0]] == ':', "index: within keeps the entries of a sub-range");
+}
+
+// The events of a file the way parseEventsFile reads them through nlohmann, the reference for the fast path
+static names_and_events parseWithNlohmann(const string &text) {
+    nlohmann::json data = nlohmann::json::parse(text);
+    names_and_events out;
+    out.team_a_name = data["team a"];
+    out.team_b_name = data["team b"];
+    for (auto &event : data["events"]) {
+        map<string, string> updates[3];
+        const char *sections[3] = {"general game updates", "team a updates", "team b updates"};
+        for (int section = 0; section < 3; section++) {
+            for (auto &update : event[sections[section]].items()) {
+                updates[section][update.key()] = update.value().is_string() ? update.value().get<string>() : update.value().dump();
+            }
+        }
+        out.events.push_back(Event(out.team_a_name, out.team_b_name, event["event name"], event["time"], updates[0], updates[1],
+                                   updates[2], event["description"]));
+    }
+    return out;
+}
+
+static bool sameEvents(const names_and_events &a, const names_and_events &b) {
+    if (a.team_a_name != b.team_a_name || a.team_b_name != b.team_b_name || a.events.size() != b.events.size()) return false;
+    for (size_t i = 0; i < a.events.size(); i++) {
+        const Event &x = a.events[i], &y = b.events[i];
+        if (x.get_name() != y.get_name() || x.get_time() != y.get_time() || x.get_discription() != y.get_discription() ||
+            x.get_game_updates() != y.get_game_updates() || x.get_team_a_updates() != y.get_team_a_updates() ||
+            x.get_team_b_updates() != y.get_team_b_updates() || x.get_team_a_name() != y.get_team_a_name() ||
+            x.get_team_b_name() != y.get_team_b_name()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The fast loader gives what nlohmann gives, and hands anything it does not expect back to it
+static void testEventLoader() {
+    for (const char *path : {"data/events1.json", "data/events1_partial.json"}) {
+        string text = readFile(path);
+        names_and_events fast;
+        check(parseEventsFast(text, fast) && sameEvents(fast, parseWithNlohmann(text)), string("loader: ") + path + " loads as nlohmann reads it");
+    }
+
+    string tricky = "{\"team a\": \"K\\u00f6ln \\\"A\\\"\", \"team b\": \"B\\/C\", \"events\": [{\"event name\": \"kick\\toff\","
+                    " \"time\": -5, \"general game updates\": {\"active\": true, \"score\": 3, \"note\": null},"
+                    " \"team a updates\": {\"goals\": \"1\\n2\"}, \"team b updates\": {},"
+                    " \"description\": \"line\\none \\u00e9\\ud83d\\ude00\"}]}";
+    names_and_events fast;
+    check(parseEventsFast(tricky, fast) && sameEvents(fast, parseWithNlohmann(tricky)), "loader: escapes and non-string stats load as nlohmann reads them");
+
+    const string rejected[] = {
+        "{\"team a\": \"A\", \"team b\": \"B\", \"events\": [{\"event name\": \"x\", \"time\": 1, \"general game updates\": {\"n\": {\"deep\": 1}},"
+        " \"team a updates\": {}, \"team b updates\": {}, \"description\": \"\"}]}",
+        "{\"team a\": \"A\", \"team b\": \"B\", \"events\": [{\"event name\": \"x\", \"time\": 1, \"general game updates\": {\"n\": 1.5},"
+        " \"team a updates\": {}, \"team b updates\": {}, \"description\": \"\"}]}",
+        "{\"team a\": \"A\", \"team b\": \"B\", \"venue\": \"X\", \"events\": []}",
+        "{\"team a\": \"A\", \"team b\": \"B\", \"events\": [",
+    };
+    bool allRejected = true;
+    for (const string &text : rejected) {
+        names_and_events out;
+        out.team_a_name = "untouched";
+        allRejected = allRejected && !parseEventsFast(text, out) && out.team_a_name == "untouched";
+    }
+    check(allRejected, "loader: nested, floating point, unknown fields and broken JSON are left to nlohmann");
+}
+
+static bool parses(const string &list, vector<BrokerEndpoint> &out) {
+    out.clear();
+    return parseBrokerList(list, out);
+}
+
+// Broker lists: names, IPv4 and bracketed IPv6, every entry or none
+static void testParseBrokerList() {
+    vector<BrokerEndpoint> brokers;
+    check(parses("stomp.example.com:7777", brokers) && brokers.size() == 1 && brokers[0].host == "stomp.example.com" &&
+          brokers[0].port == 7777, "brokers: host:port is parsed");
+    check(parses("127.0.0.1:1,[::1]:65535,b:2", brokers) && brokers.size() == 3 && brokers[1].host == "::1" &&
+          brokers[1].port == 65535 && brokers[2].host == "b", "brokers: a list keeps its order, IPv6 loses its brackets");
+    check(describeBrokers(brokers) == "127.0.0.1:1,[::1]:65535,b:2", "brokers: describeBrokers writes the list back");
+
+    vector<BrokerEndpoint> kept(1, BrokerEndpoint("kept", 1));
+    bool allRejected = true;
+    for (const char *bad : {"", "host", "host:", ":7777", "host:0", "host:65536", "host:77x", "::1:7777", "a:1,", "a:1,,b:2", "a:1,b"}) {
+        vector<BrokerEndpoint> out = kept;
+        allRejected = allRejected && !parseBrokerList(bad, out) && out.size() == 1 && out[0].host == "kept";
+    }
+    check(allRejected, "brokers: a malformed entry rejects the list and leaves the output untouched");
+}
+
+// A refused broker does not stop the race, the one that listens wins
+static void testConnectFirst() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bool listening = bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0 && listen(listener, 4) == 0 &&
+                     getsockname(listener, reinterpret_cast<sockaddr *>(&address), &length) == 0;
+    unsigned short port = ntohs(address.sin_port);
+
+    // Port 1 on loopback refuses at once
+    vector<BrokerEndpoint> brokers;
+    brokers.push_back(BrokerEndpoint("127.0.0.1", 1));
+    brokers.push_back(BrokerEndpoint("localhost", port));
+    boost::system::error_code error;
+    int fd = listening ? connectFirst(brokers, 2000, error) : -1;
+    check(fd >= 0 && !error, "brokers: connectFirst gets past a refused broker to a listening one");
+    if (fd >= 0) close(fd);
+
+    brokers.pop_back();
+    fd = connectFirst(brokers, 2000, error);
+    check(fd < 0 && error, "brokers: connectFirst fails with an error when no broker answers");
+    close(listener);
+}
+
+int main() {
+    testParseBrokerList();
+    testConnectFirst();
+    testEventLoader();
+    testScanKernels();
+    testStructuralIndex();
+    testFrameArena();
+    testParseFrame();
+    testParseEvent();
+    testDedupIds();
+    testDedupHashes();
+    testWheelScheduleAfterIdle();
+    testWheelLongDelayAfterIdle();
+    testReceiptAfterIdle();
+    testPacerOrder();
+    testPacerIdleWaitsForWrite();
+    testReplayLongerThanTimeout();
+    testCaptureTruncated();
+    testCaptureRejectsCorruptLength();
+    cout << (failures == 0 ? "all tests passed" : to_string(failures) + " checks failed") << endl;
+    return failures;
+}
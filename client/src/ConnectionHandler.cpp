@@ -1,6 +1,5 @@
 #include "../include/ConnectionHandler.h"
-
-using boost::asio::ip::tcp;
+#include <cstring>
 
 using std::cin;
 using std::cout;
@@ -8,8 +7,13 @@ using std::cerr;
 using std::endl;
 using std::string;
 
-ConnectionHandler::ConnectionHandler(string host, short port) : host_(host), port_(port), io_service_(),
-                                                                socket_(io_service_) {}
+ConnectionHandler::ConnectionHandler(string host, short port)
+    : ConnectionHandler(std::unique_ptr<Transport>(new TcpTransport(host, port))) {}
+
+ConnectionHandler::ConnectionHandler(std::unique_ptr<Transport> transport)
+    : transport_(std::move(transport)), profile_(), readBuffer_(), readPos_(0), readLen_(0), readTimeoutMs_(0), writeMutex_(),
+      lastWrite_(std::chrono::steady_clock::now()), heartbeatThread_(), heartbeatMutex_(), heartbeatCv_(),
+      heartbeatRunning_(false) {}
 
 ConnectionHandler::~ConnectionHandler() {
 	close();
@@ -17,11 +21,10 @@ ConnectionHandler::~ConnectionHandler() {
 
 bool ConnectionHandler::connect() {
 	std::cout << "Starting connect to "
-	          << host_ << ":" << port_ << std::endl;
+	          << transport_->describe() << std::endl;
 	try {
-		tcp::endpoint endpoint(boost::asio::ip::address::from_string(host_), port_); // the server endpoint
 		boost::system::error_code error;
-		socket_.connect(endpoint, error);
+		transport_->connect(error);
 		if (error)
 			throw boost::system::system_error(error);
 	}
@@ -29,18 +32,53 @@ bool ConnectionHandler::connect() {
 		std::cerr << "Connection failed (Error: " << e.what() << ')' << std::endl;
 		return false;
 	}
+	applyProfile();
 	return true;
 }
 
-bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
-	size_t tmp = 0;
+bool ConnectionHandler::attach(int fd) {
 	boost::system::error_code error;
+	transport_->attach(fd, error);
+	if (error) {
+		std::cerr << "Attach failed (Error: " << error.message() << ')' << std::endl;
+		return false;
+	}
+	applyProfile();
+	return true;
+}
+
+void ConnectionHandler::setProfile(const SocketProfile &profile) {
+	profile_ = profile;
+}
+
+void ConnectionHandler::applyProfile() {
+	// The default profile leaves the socket as the kernel made it
+	if (profile_.name == "default")
+		return;
+	for (const std::string &refused : transport_->tune(profile_))
+		std::cerr << "Socket option not applied (" << refused << ')' << std::endl;
+}
+
+void ConnectionHandler::beginBatch() {
+	transport_->cork(true);
+}
+
+void ConnectionHandler::endBatch() {
+	transport_->cork(false);
+}
+
+bool ConnectionHandler::fillBuffer() {
 	try {
-		while (!error && bytesToRead > tmp) {
-			tmp += socket_.read_some(boost::asio::buffer(bytes + tmp, bytesToRead - tmp), error);
+		boost::system::error_code error;
+		size_t read = transport_->readSome(readBuffer_, sizeof(readBuffer_), readTimeoutMs_, error);
+		if (error == boost::asio::error::timed_out) {
+			std::cerr << "recv failed (Error: nothing received for " << readTimeoutMs_ << "ms)" << std::endl;
+			return false;
 		}
 		if (error)
 			throw boost::system::system_error(error);
+		readPos_ = 0;
+		readLen_ = read;
 	} catch (std::exception &e) {
 		std::cerr << "recv failed (Error: " << e.what() << ')' << std::endl;
 		return false;
@@ -48,22 +86,38 @@ bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
 	return true;
 }
 
-bool ConnectionHandler::sendBytes(const char bytes[], int bytesToWrite) {
-	int tmp = 0;
+bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
+	size_t tmp = 0;
+	while (bytesToRead > tmp) {
+		if (readPos_ == readLen_ && !fillBuffer())
+			return false;
+		size_t chunk = std::min(bytesToRead - tmp, readLen_ - readPos_);
+		std::memcpy(bytes + tmp, readBuffer_ + readPos_, chunk);
+		readPos_ += chunk;
+		tmp += chunk;
+	}
+	return true;
+}
+
+bool ConnectionHandler::writeAll(const char bytes[], size_t bytesToWrite) {
 	boost::system::error_code error;
 	try {
-		while (!error && bytesToWrite > tmp) {
-			tmp += socket_.write_some(boost::asio::buffer(bytes + tmp, bytesToWrite - tmp), error);
-		}
+		transport_->write(bytes, bytesToWrite, nullptr, 0, error);
 		if (error)
 			throw boost::system::system_error(error);
 	} catch (std::exception &e) {
 		std::cerr << "recv failed (Error: " << e.what() << ')' << std::endl;
 		return false;
 	}
+	lastWrite_ = std::chrono::steady_clock::now();
 	return true;
 }
 
+bool ConnectionHandler::sendBytes(const char bytes[], int bytesToWrite) {
+	std::lock_guard<std::mutex> lock(writeMutex_);
+	return writeAll(bytes, bytesToWrite);
+}
+
 bool ConnectionHandler::getLine(std::string &line) {
 	return getFrameAscii(line, '\n');
 }
@@ -74,35 +128,118 @@ bool ConnectionHandler::sendLine(std::string &line) {
 
 
 bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
-	char ch;
-	// Stop when we encounter the null character.
+	// Stop when we encounter the delimiter character.
 	// Notice that the null character is not appended to the frame string.
-	try {
-		do {
-			if (!getBytes(&ch, 1)) {
-				return false;
+	while (true) {
+		if (readPos_ == readLen_ && !fillBuffer())
+			return false;
+		const char *start = readBuffer_ + readPos_;
+		size_t available = readLen_ - readPos_;
+		if (delimiter == '\0' && frame.empty()) {
+			while (available > 0 && (*start == '\n' || *start == '\r')) {
+				start++;
+				available--;
+				readPos_++;
 			}
-			if (ch != '\0')
-				frame.append(1, ch);
-		} while (delimiter != ch);
-	} catch (std::exception &e) {
-		std::cerr << "recv failed2 (Error: " << e.what() << ')' << std::endl;
+			if (available == 0)
+				continue;
+		}
+		const char *end = static_cast<const char *>(std::memchr(start, delimiter, available));
+		if (end == nullptr) {
+			frame.append(start, available);
+			readPos_ += available;
+			continue;
+		}
+		size_t length = end - start;
+		frame.append(start, delimiter == '\0' ? length : length + 1);
+		readPos_ += length + 1;
+		return true;
+	}
+}
+
+bool ConnectionHandler::sendFrameAscii(const std::string &frame, char delimiter) {
+	std::lock_guard<std::mutex> lock(writeMutex_);
+	// One gathered write: a separate 1 byte write for the delimiter gets held back by Nagle
+	boost::system::error_code error;
+	transport_->write(frame.data(), frame.size(), &delimiter, 1, error);
+	if (error) {
+		std::cerr << "send failed (Error: " << error.message() << ')' << std::endl;
 		return false;
 	}
+	lastWrite_ = std::chrono::steady_clock::now();
 	return true;
 }
 
-bool ConnectionHandler::sendFrameAscii(const std::string &frame, char delimiter) {
-	bool result = sendBytes(frame.c_str(), frame.length());
-	if (!result) return false;
-	return sendBytes(&delimiter, 1);
+bool ConnectionHandler::reconnect(const std::vector<std::string> &resumeFrames) {
+	// The heart-beat thread writes too, stop it before taking the write lock
+	stopHeartbeat();
+	std::lock_guard<std::mutex> lock(writeMutex_);
+	transport_->close();
+	readPos_ = 0;
+	readLen_ = 0;
+	readTimeoutMs_ = 0;
+	if (!connect())
+		return false;
+	const char delimiter = '\0';
+	for (const std::string &frame : resumeFrames) {
+		if (!writeAll(frame.c_str(), frame.length()) || !writeAll(&delimiter, 1))
+			return false;
+	}
+	return true;
+}
+
+void ConnectionHandler::setReadTimeout(int timeoutMs) {
+	readTimeoutMs_ = timeoutMs;
+}
+
+void ConnectionHandler::startHeartbeat(int intervalMs) {
+	stopHeartbeat();
+	if (intervalMs <= 0)
+		return;
+	std::lock_guard<std::mutex> lock(heartbeatMutex_);
+	heartbeatRunning_ = true;
+	heartbeatThread_ = std::thread(&ConnectionHandler::heartbeatLoop, this, intervalMs);
+}
+
+// The listener (reconnect, close) and the main thread (close) can both stop the heartbeat: whoever
+// takes the thread out under the lock joins it, outside the lock the loop needs to finish
+void ConnectionHandler::stopHeartbeat() {
+	std::thread heartbeat;
+	{
+		std::lock_guard<std::mutex> lock(heartbeatMutex_);
+		heartbeatRunning_ = false;
+		heartbeat = std::move(heartbeatThread_);
+	}
+	heartbeatCv_.notify_all();
+	if (heartbeat.joinable())
+		heartbeat.join();
+}
+
+void ConnectionHandler::heartbeatLoop(int intervalMs) {
+	// Waking up every half interval keeps the gap between writes under intervalMs
+	std::chrono::milliseconds half(intervalMs / 2 > 0 ? intervalMs / 2 : 1);
+	std::unique_lock<std::mutex> lock(heartbeatMutex_);
+	while (heartbeatRunning_) {
+		heartbeatCv_.wait_for(lock, half);
+		if (!heartbeatRunning_)
+			break;
+		lock.unlock();
+		bool ok = true;
+		{
+			std::lock_guard<std::mutex> writeLock(writeMutex_);
+			if (std::chrono::steady_clock::now() - lastWrite_ >= half) {
+				const char eol = '\n';
+				ok = writeAll(&eol, 1);
+			}
+		}
+		lock.lock();
+		if (!ok)
+			break;
+	}
 }
 
 // Close down the connection properly.
 void ConnectionHandler::close() {
-	try {
-		socket_.close();
-	} catch (...) {
-		std::cout << "closing failed: connection already closed" << std::endl;
-	}
+	stopHeartbeat();
+	transport_->close();
 }
@@ -0,0 +1,261 @@
+#include "../include/Connector.h"
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <boost/asio.hpp>
+#include <fcntl.h>
+#include <netdb.h>
+
+using boost::asio::ip::tcp;
+using std::string;
+using std::vector;
+
+typedef std::chrono::steady_clock Clock;
+
+// Delay before the next attempt while earlier ones are still pending (RFC 8305 recommends 250ms)
+static const int ATTEMPT_DELAY_MS = 250;
+static const int RESOLVE_CACHE_SECONDS = 60;
+
+bool parseBrokerList(const string &list, vector<BrokerEndpoint> &out) {
+    vector<BrokerEndpoint> parsed;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        string entry = list.substr(start, comma == string::npos ? string::npos : comma - start);
+        start = comma == string::npos ? list.size() + 1 : comma + 1;
+
+        size_t colon = entry.rfind(':');
+        if (colon == string::npos || colon == 0 || colon + 1 == entry.size())
+            return false;
+        string host = entry.substr(0, colon);
+        if (host.front() == '[' && host.back() == ']')
+            host = host.substr(1, host.size() - 2);
+        else if (host.find(':') != string::npos)
+            return false;   // an IPv6 literal needs brackets
+        char *end = nullptr;
+        long port = strtol(entry.c_str() + colon + 1, &end, 10);
+        if (*end != '\0' || port <= 0 || port > 65535 || host.empty())
+            return false;
+        parsed.push_back(BrokerEndpoint(host, static_cast<unsigned short>(port)));
+    }
+    out.swap(parsed);
+    return true;
+}
+
+string describeBrokers(const vector<BrokerEndpoint> &brokers) {
+    string description;
+    for (const BrokerEndpoint &broker : brokers) {
+        if (!description.empty())
+            description += ",";
+        bool v6 = broker.host.find(':') != string::npos;
+        description += (v6 ? "[" + broker.host + "]" : broker.host) + ":" + std::to_string(broker.port);
+    }
+    return description;
+}
+
+// ---- Resolver cache ----
+
+struct CachedAnswer {
+    Clock::time_point expires;
+    vector<tcp::endpoint> endpoints;
+
+    CachedAnswer() : expires(), endpoints() {}
+};
+
+static std::mutex cacheMutex;
+static std::map<string, CachedAnswer> resolveCache;
+
+static string cacheKey(const BrokerEndpoint &broker) {
+    return broker.host + ":" + std::to_string(broker.port);
+}
+
+static bool lookUpCache(const BrokerEndpoint &broker, vector<tcp::endpoint> &endpoints) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto found = resolveCache.find(cacheKey(broker));
+    if (found == resolveCache.end() || found->second.expires < Clock::now())
+        return false;
+    endpoints = found->second.endpoints;
+    return true;
+}
+
+// getaddrinfo, blocking. Runs on a thread of its own so a slow name server cannot hold up the timeout.
+static boost::system::error_code resolve(const BrokerEndpoint &broker, vector<tcp::endpoint> &endpoints) {
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+    addrinfo *answers = nullptr;
+    if (getaddrinfo(broker.host.c_str(), std::to_string(broker.port).c_str(), &hints, &answers) != 0)
+        return boost::asio::error::host_not_found;
+
+    // RFC 8305 ordering: IPv6 first, then alternate families
+    vector<tcp::endpoint> v6, v4;
+    for (addrinfo *answer = answers; answer; answer = answer->ai_next) {
+        tcp::endpoint endpoint;
+        memcpy(endpoint.data(), answer->ai_addr, answer->ai_addrlen);
+        (answer->ai_family == AF_INET6 ? v6 : v4).push_back(endpoint);
+    }
+    freeaddrinfo(answers);
+    for (size_t i = 0; i < v6.size() || i < v4.size(); i++) {
+        if (i < v6.size())
+            endpoints.push_back(v6[i]);
+        if (i < v4.size())
+            endpoints.push_back(v4[i]);
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    CachedAnswer &cached = resolveCache[cacheKey(broker)];
+    cached.expires = Clock::now() + std::chrono::seconds(RESOLVE_CACHE_SECONDS);
+    cached.endpoints = endpoints;
+    return boost::system::error_code();
+}
+
+// ---- Connection race ----
+
+// Everything runs on the thread in run() except name resolution, whose threads post back here.
+// They share ownership of the io_service only and hold a weak reference to the race, so a slow
+// getaddrinfo does not keep a finished race alive: its answer lands in an io_service nobody runs
+// and is dropped with it.
+class ConnectRace : public std::enable_shared_from_this<ConnectRace> {
+public:
+    explicit ConnectRace(const vector<BrokerEndpoint> &brokers)
+        : io(std::make_shared<boost::asio::io_service>()), attemptTimer(*io), deadline(*io), brokers(brokers), candidates(brokers.size()), nextBroker(0),
+          resolving(0), attempts(), inFlight(0), timerArmed(false), winner(-1), lastError(), done(false) {}
+
+    ConnectRace(const ConnectRace &) = delete;
+    ConnectRace &operator=(const ConnectRace &) = delete;
+
+    int run(int timeoutMs, boost::system::error_code &error) {
+        std::weak_ptr<ConnectRace> race = shared_from_this();
+        for (size_t i = 0; i < brokers.size(); i++) {
+            vector<tcp::endpoint> endpoints;
+            if (lookUpCache(brokers[i], endpoints)) {
+                candidates[i].assign(endpoints.begin(), endpoints.end());
+                continue;
+            }
+            resolving++;
+            BrokerEndpoint broker = brokers[i];
+            std::shared_ptr<boost::asio::io_service> resolvedTo = io;
+            std::thread([race, resolvedTo, broker, i]() {
+                vector<tcp::endpoint> endpoints;
+                boost::system::error_code error = resolve(broker, endpoints);
+                boost::asio::post(*resolvedTo, [race, i, endpoints, error]() {
+                    if (std::shared_ptr<ConnectRace> self = race.lock())
+                        self->resolved(i, endpoints, error);
+                });
+            }).detach();
+        }
+
+        deadline.expires_after(std::chrono::milliseconds(timeoutMs));
+        deadline.async_wait([this](const boost::system::error_code &cancelled) {
+            if (!cancelled)
+                finish(boost::asio::error::timed_out);
+        });
+        startNext();
+        io->run();
+        error = winner >= 0 ? boost::system::error_code() : lastError;
+        return winner;
+    }
+
+private:
+    void resolved(size_t broker, const vector<tcp::endpoint> &endpoints, const boost::system::error_code &error) {
+        resolving--;
+        if (done)
+            return;
+        if (error)
+            lastError = error;
+        candidates[broker].assign(endpoints.begin(), endpoints.end());
+        // Attempts in flight and a pending stagger timer pick the new candidates up on their own
+        if (!timerArmed)
+            startNext();
+    }
+
+    void startNext() {
+        if (done)
+            return;
+        for (size_t tried = 0; tried < candidates.size(); tried++) {
+            size_t broker = (nextBroker + tried) % candidates.size();
+            if (candidates[broker].empty())
+                continue;
+            tcp::endpoint endpoint = candidates[broker].front();
+            candidates[broker].pop_front();
+            nextBroker = broker + 1;
+
+            size_t attempt = attempts.size();
+            attempts.push_back(std::unique_ptr<tcp::socket>(new tcp::socket(*io)));
+            inFlight++;
+            attempts[attempt]->async_connect(endpoint, [this, attempt](const boost::system::error_code &error) {
+                attemptDone(attempt, error);
+            });
+
+            timerArmed = true;
+            attemptTimer.expires_after(std::chrono::milliseconds(ATTEMPT_DELAY_MS));
+            attemptTimer.async_wait([this](const boost::system::error_code &cancelled) {
+                if (!cancelled) {
+                    timerArmed = false;
+                    startNext();
+                }
+            });
+            return;
+        }
+        timerArmed = false;
+        if (inFlight == 0 && resolving == 0)
+            finish(lastError ? lastError : boost::system::error_code(boost::asio::error::host_not_found));
+    }
+
+    void attemptDone(size_t attempt, const boost::system::error_code &error) {
+        inFlight--;
+        if (done)
+            return;
+        if (error) {
+            lastError = error;
+            attempts[attempt].reset();
+            startNext();
+            return;
+        }
+        winner = attempts[attempt]->release();
+        // Back to blocking, the way a plain connect() leaves it
+        fcntl(winner, F_SETFL, fcntl(winner, F_GETFL, 0) & ~O_NONBLOCK);
+        finish(boost::system::error_code());
+    }
+
+    void finish(const boost::system::error_code &error) {
+        done = true;
+        if (error)
+            lastError = error;
+        attemptTimer.cancel();
+        deadline.cancel();
+        // Closing the losers aborts their connects
+        attempts.clear();
+        io->stop();
+    }
+
+    // Shared with resolver threads still running, declared first so the sockets and timers go before it
+    std::shared_ptr<boost::asio::io_service> io;
+    boost::asio::steady_timer attemptTimer;
+    boost::asio::steady_timer deadline;
+    vector<BrokerEndpoint> brokers;
+    vector<std::deque<tcp::endpoint>> candidates;      // per broker, not tried yet
+    size_t nextBroker;
+    size_t resolving;
+    vector<std::unique_ptr<tcp::socket>> attempts;
+    size_t inFlight;
+    bool timerArmed;
+    int winner;
+    boost::system::error_code lastError;
+    bool done;
+};
+
+int connectFirst(const vector<BrokerEndpoint> &brokers, int timeoutMs, boost::system::error_code &error) {
+    if (brokers.empty()) {
+        error = boost::asio::error::invalid_argument;
+        return -1;
+    }
+    std::shared_ptr<ConnectRace> race = std::make_shared<ConnectRace>(brokers);
+    return race->run(timeoutMs, error);
+}
@@ -0,0 +1,94 @@
+#include "../include/DedupWindow.h"
+#include <algorithm>
+
+using namespace std;
+
+// Tables are kept at most half full so linear probes stay short
+static size_t tableSizeFor(size_t capacity) {
+    size_t size = 16;
+    while (size < capacity * 2) size <<= 1;
+    return size;
+}
+
+DedupWindow::DedupWindow(size_t idWindow, size_t hashCapacity)
+    : idBits((max<size_t>(idWindow, 64) + 63) / 64, 0), highestId(-1), hashCapacity(max<size_t>(hashCapacity, 1)),
+      currentHashes(tableSizeFor(this->hashCapacity), 0), previousHashes(tableSizeFor(this->hashCapacity), 0),
+      currentCount(0) {}
+
+bool DedupWindow::seenId(long messageId) {
+    if (messageId < 0) return false;
+    const long window = (long)idBits.size() * 64;
+
+    if (highestId < 0 || messageId > highestId) {
+        // Slide forward, clearing the slots of the IDs skipped on the way
+        if (highestId < 0 || messageId - highestId >= window) {
+            fill(idBits.begin(), idBits.end(), 0);
+        } else {
+            for (long id = highestId + 1; id < messageId; id++) idBits[(id % window) / 64] &= ~(1ULL << (id % 64));
+        }
+        highestId = messageId;
+        idBits[(messageId % window) / 64] |= 1ULL << (messageId % 64);
+        return false;
+    }
+    if (messageId <= highestId - window) return false;
+
+    uint64_t &word = idBits[(messageId % window) / 64];
+    uint64_t bit = 1ULL << (messageId % 64);
+    bool seen = (word & bit) != 0;
+    word |= bit;
+    return seen;
+}
+
+bool DedupWindow::seenHash(uint64_t hash) {
+    if (hash == 0) hash = 1;    // 0 marks an empty slot
+    if (contains(previousHashes, hash)) return true;
+    if (currentCount >= hashCapacity) {
+        previousHashes.swap(currentHashes);
+        fill(currentHashes.begin(), currentHashes.end(), 0);
+        currentCount = 0;
+    }
+    return !insert(currentHashes, hash, currentCount);
+}
+
+void DedupWindow::resetIds() {
+    fill(idBits.begin(), idBits.end(), 0);
+    highestId = -1;
+}
+
+uint64_t DedupWindow::hashEvent(StrView user, StrView game, int time, StrView name) {
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](StrView field) {
+        for (size_t i = 0; i < field.size; i++) {
+            hash ^= static_cast<unsigned char>(field.data[i]);
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xff;   // field separator, so ("ab","c") and ("a","bc") differ
+        hash *= 1099511628211ULL;
+    };
+    mix(user);
+    mix(game);
+    string timeText = to_string(time);
+    mix(StrView(timeText));
+    mix(name);
+    return hash;
+}
+
+bool DedupWindow::insert(vector<uint64_t> &table, uint64_t hash, size_t &count) {
+    size_t mask = table.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        if (table[slot] == hash) return false;
+        if (table[slot] == 0) {
+            table[slot] = hash;
+            count++;
+            return true;
+        }
+    }
+}
+
+bool DedupWindow::contains(const vector<uint64_t> &table, uint64_t hash) {
+    size_t mask = table.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        if (table[slot] == hash) return true;
+        if (table[slot] == 0) return false;
+    }
+}
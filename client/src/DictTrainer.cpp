@@ -0,0 +1,130 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../include/event.h"
+
+using namespace std;
+
+// Trains the BodyCodec dictionary on sample event files and prints it as a C++ header:
+//   DictTrainer {events file...} > include/BodyDictionary.h      (make dictionary)
+// Bodies are laid out the way StompProtocol::buildEventBody sends full reports. Phrases are picked
+// greedily by bytes saved (occurrences times length minus the two byte token); the occurrences of
+// each pick are cut out of the corpus before the next one is counted, so overlapping phrases do not
+// claim the same bytes twice.
+
+static const size_t MAX_ENTRIES = 95;       // token index must stay a printable character
+static const size_t MIN_PHRASE = 3;         // shorter phrases do not beat the two byte token
+static const size_t MAX_PHRASE = 24;
+// A phrase must turn up in this many bodies: a file repeating another's events (events1_partial.json)
+// would otherwise make whole sentences of one description look worth a token
+static const size_t MIN_BODIES = 3;
+static const char CUT = '\x01';             // BodyCodec's escape byte, never part of a phrase
+
+static void appendSection(string &body, const string &title, const map<string, string> &updates) {
+    body += title + "\n";
+    for (auto const &update : updates) body += update.first + ": " + update.second + "\n";
+}
+
+static string buildBody(const Event &event) {
+    string body = "user: \n";
+    body += "team a: " + event.get_team_a_name() + "\n";
+    body += "team b: " + event.get_team_b_name() + "\n";
+    body += "event name: " + event.get_name() + "\n";
+    body += "time: " + to_string(event.get_time()) + "\n";
+    appendSection(body, "general game updates:", event.get_game_updates());
+    appendSection(body, "team a updates:", event.get_team_a_updates());
+    appendSection(body, "team b updates:", event.get_team_b_updates());
+    body += "description:\n" + event.get_discription();
+    return body;
+}
+
+// Most bytes saved by any phrase of the corpus, empty if nothing saves anything
+static string bestPhrase(const vector<string> &corpus) {
+    struct Count {
+        size_t occurrences;
+        size_t bodies;
+        size_t lastBody;
+    };
+    unordered_map<string, Count> counts;
+    for (size_t b = 0; b < corpus.size(); b++) {
+        const string &body = corpus[b];
+        for (size_t start = 0; start < body.size(); start++) {
+            for (size_t length = 1; length <= MAX_PHRASE && start + length <= body.size(); length++) {
+                if (body[start + length - 1] == CUT) break;
+                if (length < MIN_PHRASE) continue;
+                auto inserted = counts.insert(make_pair(body.substr(start, length), Count{0, 0, 0}));
+                Count &count = inserted.first->second;
+                count.occurrences++;
+                if (inserted.second || count.lastBody != b) {
+                    count.bodies++;
+                    count.lastBody = b;
+                }
+            }
+        }
+    }
+    string best;
+    size_t bestSaved = 0;
+    for (auto const &entry : counts) {
+        if (entry.second.bodies < MIN_BODIES) continue;
+        size_t saved = entry.second.occurrences * (entry.first.size() - 2);
+        // Ties go to the smaller string, so the output does not depend on hash order
+        if (saved > bestSaved || (saved == bestSaved && entry.first < best)) {
+            best = entry.first;
+            bestSaved = saved;
+        }
+    }
+    return best;
+}
+
+static void cutOut(vector<string> &corpus, const string &phrase) {
+    for (string &body : corpus) {
+        for (size_t at = body.find(phrase); at != string::npos; at = body.find(phrase, at + 1)) {
+            body.replace(at, phrase.size(), 1, CUT);
+        }
+    }
+}
+
+static string literal(const string &phrase) {
+    string out = "\"";
+    for (char c : phrase) {
+        if (c == '\n') out += "\\n";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\\') out += "\\\\";
+        else out += c;
+    }
+    return out + "\"";
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " {events file...}" << endl;
+        return 1;
+    }
+    vector<string> corpus;
+    for (int i = 1; i < argc; i++) {
+        try {
+            for (const Event &event : parseEventsFile(argv[i]).events) corpus.push_back(buildBody(event));
+        } catch (...) {
+            cerr << "Error parsing file " << argv[i] << endl;
+            return 1;
+        }
+    }
+
+    vector<string> dictionary;
+    while (dictionary.size() < MAX_ENTRIES) {
+        string phrase = bestPhrase(corpus);
+        if (phrase.empty()) break;
+        dictionary.push_back(phrase);
+        cutOut(corpus, phrase);
+    }
+
+    cout << "#pragma once\n\n";
+    cout << "// Generated by DictTrainer from the sample event files (make dictionary), do not edit.\n";
+    cout << "// Regenerating changes the tokens: bump BodyCodec::ENCODING_NAME with it.\n";
+    cout << "static const char *const DICTIONARY[] = {\n";
+    for (const string &phrase : dictionary) cout << "    " << literal(phrase) << ",\n";
+    cout << "};\n";
+    return 0;
+}
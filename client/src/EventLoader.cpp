@@ -0,0 +1,464 @@
+#include "../include/EventLoader.h"
+#include "../include/EventSchema.h"
+#include <cstring>
+#include <climits>
+#include <cctype>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LOADER_X86 1
+#endif
+
+using namespace std;
+
+// ---- Stage one: structural index ----
+
+// Bit i of each mask describes byte i of a 64-byte block
+struct BlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;            // { } [ ] : ,
+    uint64_t whitespace;    // \t \n \r
+    uint64_t control;       // below 0x20, whitespace included
+    uint64_t high;          // 0x80 and up, part of a multi-byte UTF-8 sequence
+};
+
+static void classifyScalar(const char *block, BlockMasks &m) {
+    m = BlockMasks();
+    for (int i = 0; i < 64; i++) {
+        unsigned char c = static_cast<unsigned char>(block[i]);
+        uint64_t bit = 1ULL << i;
+        if (c == '"') m.quote |= bit;
+        else if (c == '\\') m.backslash |= bit;
+        else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',') m.op |= bit;
+        if (c == '\t' || c == '\n' || c == '\r') m.whitespace |= bit;
+        if (c < 0x20) m.control |= bit;
+        if (c >= 0x80) m.high |= bit;
+    }
+}
+
+#ifdef LOADER_X86
+__attribute__((target("sse2")))
+static void classifySse2(const char *block, BlockMasks &m) {
+    m = BlockMasks();
+    for (int lane = 0; lane < 4; lane++) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + lane * 16));
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('{')), _mm_cmpeq_epi8(x, _mm_set1_epi8('}'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('[')), _mm_cmpeq_epi8(x, _mm_set1_epi8(']'))));
+        op = _mm_or_si128(op, _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(':')), _mm_cmpeq_epi8(x, _mm_set1_epi8(','))));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(x, _mm_set1_epi8('\n'))),
+                                  _mm_cmpeq_epi8(x, _mm_set1_epi8('\r')));
+        // Signed compare: true for bytes below 0x20 and for bytes with the high bit set
+        __m128i lowOrHigh = _mm_cmpgt_epi8(_mm_set1_epi8(0x20), x);
+        int shift = lane * 16;
+        uint64_t high = static_cast<uint32_t>(_mm_movemask_epi8(x));
+        m.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('"'))))) << shift;
+        m.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))))) << shift;
+        m.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(op))) << shift;
+        m.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(ws))) << shift;
+        m.control |= (static_cast<uint32_t>(_mm_movemask_epi8(lowOrHigh)) & ~high) << shift;
+        m.high |= high << shift;
+    }
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const char *block, BlockMasks &m) {
+    m = BlockMasks();
+    for (int lane = 0; lane < 2; lane++) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + lane * 32));
+        __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('}'))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(']'))));
+        op = _mm256_or_si256(op, _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(','))));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n'))),
+                                     _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r')));
+        __m256i lowOrHigh = _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), x);
+        int shift = lane * 32;
+        uint64_t high = static_cast<uint32_t>(_mm256_movemask_epi8(x));
+        m.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'))))) << shift;
+        m.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))))) << shift;
+        m.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(op))) << shift;
+        m.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ws))) << shift;
+        m.control |= (static_cast<uint32_t>(_mm256_movemask_epi8(lowOrHigh)) & ~high) << shift;
+        m.high |= high << shift;
+    }
+}
+#endif
+
+static void classify(ScanKernel kernel, const char *block, BlockMasks &m) {
+#ifdef LOADER_X86
+    if (kernel == ScanKernel::AVX2) return classifyAvx2(block, m);
+    if (kernel == ScanKernel::SSE2) return classifySse2(block, m);
+#endif
+    (void)kernel;
+    classifyScalar(block, m);
+}
+
+// Bit i of the result is the XOR of bits 0..i, so it is set between an opening and a closing quote
+static inline uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+static bool validUtf8(const string &text) {
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(text.data());
+    size_t n = text.size();
+    for (size_t i = 0; i < n;) {
+        unsigned char c = p[i];
+        if (c < 0x80) { i++; continue; }
+        size_t len;
+        uint32_t cp;
+        if ((c & 0xE0) == 0xC0) { len = 2; cp = c & 0x1F; }
+        else if ((c & 0xF0) == 0xE0) { len = 3; cp = c & 0x0F; }
+        else if ((c & 0xF8) == 0xF0) { len = 4; cp = c & 0x07; }
+        else return false;
+        if (i + len > n) return false;
+        for (size_t k = 1; k < len; k++) {
+            if ((p[i + k] & 0xC0) != 0x80) return false;
+            cp = (cp << 6) | (p[i + k] & 0x3F);
+        }
+        // Overlong forms, surrogates and values past U+10FFFF
+        if ((len == 2 && cp < 0x80) || (len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000) ||
+            (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) return false;
+        i += len;
+    }
+    return true;
+}
+
+bool indexJson(ScanKernel kernel, const string &json, vector<uint32_t> &positions) {
+    positions.clear();
+    positions.reserve(json.size() / 8);
+    size_t size = json.size();
+    uint64_t escapeCarry = 0;       // the previous block ended in an escaping backslash
+    uint64_t inStringCarry = 0;     // the previous block ended inside a string
+    bool sawHigh = false;
+    char tail[64];
+
+    for (size_t base = 0; base < size; base += 64) {
+        const char *block = json.data() + base;
+        if (size - base < 64) {
+            // Pad the last block with spaces, they are not structural
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, size - base);
+            block = tail;
+        }
+        BlockMasks m;
+        classify(kernel, block, m);
+
+        // Backslashes are rare in event files, resolve escapes one at a time
+        uint64_t escaped = escapeCarry;
+        uint64_t backslash = m.backslash & ~escapeCarry;
+        escapeCarry = 0;
+        while (backslash) {
+            int bit = __builtin_ctzll(backslash);
+            if (bit == 63) {
+                escapeCarry = 1;
+                break;
+            }
+            escaped |= 1ULL << (bit + 1);
+            backslash &= ~(3ULL << bit);
+        }
+
+        uint64_t quotes = m.quote & ~escaped;
+        uint64_t inString = prefixXor(quotes) ^ inStringCarry;
+        inStringCarry = (static_cast<int64_t>(inString) >> 63);
+
+        // Control characters are never valid inside a string, and only \t \n \r are valid outside
+        if ((m.control & inString) || (m.control & ~m.whitespace)) return false;
+        sawHigh = sawHigh || m.high != 0;
+
+        uint64_t structural = (m.op & ~inString) | quotes;
+        while (structural) {
+            positions.push_back(static_cast<uint32_t>(base + __builtin_ctzll(structural)));
+            structural &= structural - 1;
+        }
+    }
+    if (inStringCarry) return false;
+    return !sawHigh || validUtf8(json);
+}
+
+// ---- Stage two: schema walk ----
+
+namespace {
+
+struct RawEvent {
+    string name;
+    int time;
+    map<string, string> updates[3];     // general, team a, team b
+    string description;
+
+    RawEvent() : name(), time(0), updates(), description() {}
+};
+
+// Thrown for anything the fast path does not handle, the caller falls back to nlohmann
+struct Unexpected {};
+
+class SchemaWalker {
+public:
+    SchemaWalker(const string &text, const vector<uint32_t> &positions)
+        : text(text), positions(positions), next(0), consumed(0) {}
+
+    void parse(string &teamA, string &teamB, vector<RawEvent> &events) {
+        unsigned seen = 0;
+        expect('{');
+        do {
+            EventField field = readKey();
+            expect(':');
+            switch (field) {
+                case EventField::TEAM_A: teamA = readString(); break;
+                case EventField::TEAM_B: teamB = readString(); break;
+                case EventField::EVENTS: readEvents(events); break;
+                default: throw Unexpected();
+            }
+            seen |= bit(field);
+        } while (moreMembers('}'));
+        if (seen != (bit(EventField::TEAM_A) | bit(EventField::TEAM_B) | bit(EventField::EVENTS)) || next != positions.size()) {
+            throw Unexpected();
+        }
+        skipSpace(text.size());
+    }
+
+private:
+    char peek() const {
+        if (next >= positions.size()) throw Unexpected();
+        return text[positions[next]];
+    }
+
+    // Anything between two tokens must be whitespace
+    void skipSpace(size_t to) {
+        for (; consumed < to; consumed++) {
+            char c = text[consumed];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') throw Unexpected();
+        }
+    }
+
+    void expect(char c) {
+        if (peek() != c) throw Unexpected();
+        skipSpace(positions[next]);
+        consumed = positions[next++] + 1;
+    }
+
+    // After a value: true if a ',' follows, false if the closing character does
+    bool moreMembers(char close) {
+        char c = peek();
+        if (c == ',') { expect(','); return true; }
+        if (c == close) { expect(close); return false; }
+        throw Unexpected();
+    }
+
+    // Positions of the quotes around the next string
+    void readQuotes(size_t &open, size_t &close) {
+        if (peek() != '"' || next + 1 >= positions.size()) throw Unexpected();
+        skipSpace(positions[next]);
+        open = positions[next];
+        close = positions[next + 1];
+        if (text[close] != '"') throw Unexpected();
+        next += 2;
+        consumed = close + 1;
+    }
+
+    static unsigned bit(EventField field) {
+        return 1u << static_cast<int>(field);
+    }
+
+    // Keys are bound to schema fields without copying them out; escaped keys are left to nlohmann
+    EventField readKey() {
+        size_t open, close;
+        readQuotes(open, close);
+        EventField field = lookupEventField(text.data() + open + 1, close - open - 1);
+        if (field == EventField::UNKNOWN) throw Unexpected();
+        return field;
+    }
+
+    string readString() {
+        size_t open, close;
+        readQuotes(open, close);
+        const char *raw = text.data() + open + 1;
+        size_t length = close - open - 1;
+        if (!memchr(raw, '\\', length)) return string(raw, length);
+        return unescape(raw, length);
+    }
+
+    static unsigned hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        throw Unexpected();
+    }
+
+    static unsigned readHex4(const char *p) {
+        return (hexDigit(p[0]) << 12) | (hexDigit(p[1]) << 8) | (hexDigit(p[2]) << 4) | hexDigit(p[3]);
+    }
+
+    static void appendUtf8(string &out, uint32_t cp) {
+        if (cp < 0x80) out += static_cast<char>(cp);
+        else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    static string unescape(const char *raw, size_t length) {
+        string out;
+        out.reserve(length);
+        for (size_t i = 0; i < length; i++) {
+            if (raw[i] != '\\') {
+                out += raw[i];
+                continue;
+            }
+            if (++i >= length) throw Unexpected();
+            switch (raw[i]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    if (i + 4 >= length) throw Unexpected();
+                    uint32_t cp = readHex4(raw + i + 1);
+                    i += 4;
+                    if (cp >= 0xDC00 && cp <= 0xDFFF) throw Unexpected();
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        // High surrogate, must be followed by an escaped low one
+                        if (i + 6 >= length || raw[i + 1] != '\\' || raw[i + 2] != 'u') throw Unexpected();
+                        uint32_t low = readHex4(raw + i + 3);
+                        if (low < 0xDC00 || low > 0xDFFF) throw Unexpected();
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default: throw Unexpected();
+            }
+        }
+        return out;
+    }
+
+    // Numbers, true, false and null are not in the index: they run up to the next token.
+    // Returned as nlohmann's dump() would print them; floats are left to nlohmann.
+    string readScalar() {
+        if (next >= positions.size()) throw Unexpected();
+        size_t end = positions[next];
+        while (consumed < end && isspace(static_cast<unsigned char>(text[consumed]))) consumed++;
+        size_t last = end;
+        while (last > consumed && isspace(static_cast<unsigned char>(text[last - 1]))) last--;
+        string value = text.substr(consumed, last - consumed);
+        consumed = last;
+        if (value == "true" || value == "false" || value == "null") return value;
+
+        size_t digits = (!value.empty() && value[0] == '-') ? 1 : 0;
+        if (digits == value.size() || value.size() - digits > 18) throw Unexpected();
+        if (value[digits] == '0' && value.size() - digits > 1) throw Unexpected();
+        for (size_t i = digits; i < value.size(); i++) {
+            if (value[i] < '0' || value[i] > '9') throw Unexpected();
+        }
+        if (value == "-0") throw Unexpected();
+        return value;
+    }
+
+    void readUpdates(map<string, string> &updates) {
+        expect('{');
+        if (peek() == '}') {
+            expect('}');
+            return;
+        }
+        do {
+            string key = readString();
+            expect(':');
+            char c = peek();
+            if (c == '"') updates[key] = readString();
+            else if (c == ',' || c == '}') updates[key] = readScalar();
+            else throw Unexpected();
+        } while (moreMembers('}'));
+    }
+
+    void readEvent(RawEvent &event) {
+        static const unsigned ALL_FIELDS = bit(EventField::EVENT_NAME) | bit(EventField::TIME) | bit(EventField::GENERAL_UPDATES) |
+                                           bit(EventField::TEAM_A_UPDATES) | bit(EventField::TEAM_B_UPDATES) | bit(EventField::DESCRIPTION);
+        unsigned seen = 0;
+        expect('{');
+        do {
+            EventField field = readKey();
+            expect(':');
+            switch (field) {
+                case EventField::EVENT_NAME: event.name = readString(); break;
+                case EventField::TIME: event.time = readTime(); break;
+                case EventField::GENERAL_UPDATES: readUpdates(event.updates[0]); break;
+                case EventField::TEAM_A_UPDATES: readUpdates(event.updates[1]); break;
+                case EventField::TEAM_B_UPDATES: readUpdates(event.updates[2]); break;
+                case EventField::DESCRIPTION: event.description = readString(); break;
+                default: throw Unexpected();
+            }
+            seen |= bit(field);
+        } while (moreMembers('}'));
+        if (seen != ALL_FIELDS) throw Unexpected();
+    }
+
+    int readTime() {
+        if (peek() != ',' && peek() != '}') throw Unexpected();
+        string value = readScalar();
+        long time = strtol(value.c_str(), nullptr, 10);
+        if (value == "true" || value == "false" || value == "null" || time < INT_MIN || time > INT_MAX) throw Unexpected();
+        return static_cast<int>(time);
+    }
+
+    void readEvents(vector<RawEvent> &events) {
+        expect('[');
+        if (peek() == ']') {
+            expect(']');
+            return;
+        }
+        do {
+            events.push_back(RawEvent());
+            readEvent(events.back());
+        } while (moreMembers(']'));
+    }
+
+    const string &text;
+    const vector<uint32_t> &positions;
+    size_t next;        // next entry of positions
+    size_t consumed;    // first byte of text not parsed yet
+};
+
+}
+
+bool parseEventsFast(const string &json, names_and_events &out) {
+    vector<uint32_t> positions;
+    if (!indexJson(bestScanKernel(), json, positions)) return false;
+
+    string teamA, teamB;
+    vector<RawEvent> raw;
+    try {
+        SchemaWalker(json, positions).parse(teamA, teamB, raw);
+    } catch (const Unexpected &) {
+        return false;
+    }
+
+    // The team names may come after the events, so the Events are built last
+    out.team_a_name = teamA;
+    out.team_b_name = teamB;
+    out.events.clear();
+    out.events.reserve(raw.size());
+    for (auto &event : raw) {
+        out.events.push_back(Event(teamA, teamB, event.name, event.time, event.updates[0], event.updates[1],
+                                   event.updates[2], event.description));
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#include "../include/EventStore.h"
+
+using namespace std;
+
+uint32_t StringInterner::intern(const string &s) {
+    auto found = ids.find(s);
+    if (found != ids.end()) return found->second;
+    uint32_t id = static_cast<uint32_t>(strings.size());
+    auto inserted = ids.insert(make_pair(s, id)).first;
+    strings.push_back(&inserted->first);
+    return id;
+}
+
+size_t StringInterner::bytesUsed() const {
+    size_t total = strings.capacity() * sizeof(const string *);
+    for (auto const &entry : ids) total += sizeof(entry) + entry.first.capacity();
+    return total;
+}
+
+EventStore::EventStore() : events(), stats(), strings(), descriptions() {}
+
+uint32_t EventStore::add(const Event &event) {
+    StoredEvent stored;
+    stored.time = event.get_time();
+    stored.nameId = strings.intern(event.get_name());
+    stored.descriptionId = descriptions.acquire(StrView(event.get_discription()));
+
+    stored.firstStat = static_cast<uint32_t>(stats.size());
+    addStats(event.get_game_updates(), StatView::GENERAL);
+    addStats(event.get_team_a_updates(), StatView::TEAM_A);
+    addStats(event.get_team_b_updates(), StatView::TEAM_B);
+    stored.statCount = static_cast<uint32_t>(stats.size()) - stored.firstStat;
+    return events.push(stored);
+}
+
+void EventStore::addStats(const map<string, string> &updates, uint8_t section) {
+    for (auto const &update : updates) {
+        StatDelta delta;
+        delta.section = section;
+        delta.keyId = strings.intern(update.first);
+        delta.valueId = strings.intern(update.second);
+        stats.push(delta);
+    }
+}
+
+StrView EventStore::description(const StoredEvent &event) const {
+    return descriptions.get(event.descriptionId);
+}
+
+size_t EventStore::bytesUsed() const {
+    return events.bytesReserved() + stats.bytesReserved() + strings.bytesUsed() + descriptions.stats().bytesReserved;
+}
@@ -0,0 +1,91 @@
+#include "../include/FlowController.h"
+#include <algorithm>
+
+using namespace std;
+
+// A round trip this many times the best one seen means the broker is queueing our frames
+static const long CONGESTION_RTT_FACTOR = 2;
+
+FlowController::FlowController(int minWindow, int initialWindow, int maxWindow)
+    : mutex(), creditCv(), minWindow(1), maxWindow(1), window(1), inFlight(0), smoothedRtt(0), baseRtt(0),
+      lastDecrease() {
+    reset(minWindow, initialWindow, maxWindow);
+}
+
+void FlowController::acquire() {
+    unique_lock<std::mutex> lock(mutex);
+    creditCv.wait(lock, [this]() { return inFlight < (int)window; });
+}
+
+void FlowController::sent() {
+    lock_guard<std::mutex> lock(mutex);
+    inFlight++;
+}
+
+void FlowController::onAck(int frames, long rttMicros) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        inFlight = max(0, inFlight - frames);
+        smoothedRtt = smoothedRtt == 0 ? rttMicros : (7 * smoothedRtt + rttMicros) / 8;
+        if (baseRtt == 0 || rttMicros < baseRtt) baseRtt = rttMicros;
+
+        if (rttMicros > CONGESTION_RTT_FACTOR * baseRtt) {
+            decrease();
+        } else {
+            // Additive increase: about one frame per window of confirmed frames
+            window = min((double)maxWindow, window + (double)frames / window);
+        }
+    }
+    creditCv.notify_all();
+}
+
+void FlowController::onLoss(int frames) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        inFlight = max(0, inFlight - frames);
+        decrease();
+    }
+    creditCv.notify_all();
+}
+
+void FlowController::reset(int minWindow, int initialWindow, int maxWindow) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        this->minWindow = max(1, minWindow);
+        this->maxWindow = max(this->minWindow, maxWindow);
+        window = min((double)this->maxWindow, (double)max(this->minWindow, initialWindow));
+        inFlight = 0;
+        smoothedRtt = 0;
+        baseRtt = 0;
+        lastDecrease = chrono::steady_clock::time_point();
+    }
+    creditCv.notify_all();
+}
+
+int FlowController::getWindow() const {
+    lock_guard<std::mutex> lock(mutex);
+    return (int)window;
+}
+
+int FlowController::getInFlight() const {
+    lock_guard<std::mutex> lock(mutex);
+    return inFlight;
+}
+
+long FlowController::getSmoothedRttMicros() const {
+    lock_guard<std::mutex> lock(mutex);
+    return smoothedRtt;
+}
+
+long FlowController::getBaseRttMicros() const {
+    lock_guard<std::mutex> lock(mutex);
+    return baseRtt;
+}
+
+void FlowController::decrease() {
+    // Every receipt of a congested round trip is late, react to the first one only
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (now - lastDecrease < chrono::microseconds(smoothedRtt)) return;
+    lastDecrease = now;
+    window = max((double)minWindow, window / 2);
+}
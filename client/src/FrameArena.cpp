@@ -0,0 +1,43 @@
+#include "../include/FrameArena.h"
+#include <cstdint>
+
+using namespace std;
+
+FrameArena::FrameArena(size_t chunkSize) : chunkSize(chunkSize > 0 ? chunkSize : 1024), chunks(), current(0), offset(0), used(0) {}
+
+FrameArena::~FrameArena() {
+    for (auto &chunk : chunks) delete[] chunk.first;
+}
+
+void *FrameArena::allocate(size_t bytes, size_t alignment) {
+    while (current < chunks.size()) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(chunks[current].first);
+        size_t aligned = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (aligned + bytes <= chunks[current].second) {
+            offset = aligned + bytes;
+            used += bytes;
+            return chunks[current].first + aligned;
+        }
+        // Kept chunks are reused in order, move on to the next one
+        current++;
+        offset = 0;
+    }
+
+    size_t size = bytes + alignment > chunkSize ? bytes + alignment : chunkSize;
+    chunks.push_back(make_pair(new char[size], size));
+    current = chunks.size() - 1;
+    offset = 0;
+    return allocate(bytes, alignment);
+}
+
+void FrameArena::reset() {
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+size_t FrameArena::capacity() const {
+    size_t total = 0;
+    for (auto const &chunk : chunks) total += chunk.second;
+    return total;
+}
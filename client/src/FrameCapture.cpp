@@ -0,0 +1,147 @@
+#include "../include/FrameCapture.h"
+#include <cstring>
+
+using std::string;
+
+static const char CAPTURE_MAGIC[8] = {'S', 'T', 'O', 'M', 'P', 'C', 'A', 'P'};
+static const char CAPTURE_VERSION = 1;
+static const size_t CAPTURE_FLUSH_BYTES = 64 * 1024;
+static const int CAPTURE_FLUSH_MS = 1000;
+
+static void appendVarint(std::vector<char> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+FrameCaptureWriter::FrameCaptureWriter()
+    : capturing(false), mutex(), out(), buffer(), last(), lastFlush(), frames(0) {}
+
+FrameCaptureWriter::~FrameCaptureWriter() {
+    stop();
+}
+
+bool FrameCaptureWriter::start(const string &path) {
+    stop();
+    std::lock_guard<std::mutex> lock(mutex);
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    uint64_t startUs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    buffer.assign(CAPTURE_MAGIC, CAPTURE_MAGIC + sizeof(CAPTURE_MAGIC));
+    buffer.push_back(CAPTURE_VERSION);
+    for (int i = 0; i < 8; i++) {
+        buffer.push_back(static_cast<char>(startUs >> (8 * i)));
+    }
+    last = lastFlush = Clock::now();
+    frames = 0;
+    capturing = true;
+    return true;
+}
+
+unsigned long FrameCaptureWriter::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!capturing) {
+        return 0;
+    }
+    capturing = false;
+    flush();
+    out.close();
+    return frames;
+}
+
+void FrameCaptureWriter::record(const string &frame) {
+    if (!active()) {
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!capturing) {
+        return;
+    }
+
+    appendVarint(buffer, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count()));
+    appendVarint(buffer, frame.size());
+    buffer.insert(buffer.end(), frame.begin(), frame.end());
+    last = now;
+    frames++;
+    if (buffer.size() >= CAPTURE_FLUSH_BYTES || now - lastFlush >= std::chrono::milliseconds(CAPTURE_FLUSH_MS)) {
+        flush();
+        lastFlush = now;
+    }
+}
+
+void FrameCaptureWriter::flush() {
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+    buffer.clear();
+}
+
+FrameCaptureReader::FrameCaptureReader() : in(), fileSize(0), startUs(0), offsetNs(0) {}
+
+bool FrameCaptureReader::open(const string &path, string &error) {
+    in.open(path, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    in.seekg(0, std::ios::end);
+    fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0, std::ios::beg);
+
+    char header[sizeof(CAPTURE_MAGIC) + 1 + 8];
+    if (!in.read(header, sizeof(header)) || memcmp(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+        error = path + " is not a frame capture";
+        return false;
+    }
+    if (header[sizeof(CAPTURE_MAGIC)] != CAPTURE_VERSION) {
+        error = path + " has capture version " + std::to_string(header[sizeof(CAPTURE_MAGIC)]) + ", expected " +
+                std::to_string(CAPTURE_VERSION);
+        return false;
+    }
+    startUs = 0;
+    for (int i = 0; i < 8; i++) {
+        startUs |= static_cast<uint64_t>(static_cast<unsigned char>(header[sizeof(CAPTURE_MAGIC) + 1 + i])) << (8 * i);
+    }
+    offsetNs = 0;
+    return true;
+}
+
+bool FrameCaptureReader::next(CapturedFrame &out) {
+    uint64_t deltaNs, length;
+    if (!readVarint(deltaNs) || !readVarint(length)) {
+        return false;
+    }
+    // A corrupt length must not size the frame: no record is longer than what is left of the file
+    uint64_t remaining = fileSize - static_cast<uint64_t>(in.tellg());
+    if (length > remaining) {
+        return false;
+    }
+    out.frame.resize(length);
+    if (length > 0 && !in.read(&out.frame[0], static_cast<std::streamsize>(length))) {
+        return false;
+    }
+    offsetNs += deltaNs;
+    out.offsetNs = offsetNs;
+    return true;
+}
+
+bool FrameCaptureReader::readVarint(uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
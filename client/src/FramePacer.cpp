@@ -0,0 +1,134 @@
+#include "../include/FramePacer.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+// 1 ms ticks, one turn of the wheel every 4 s; later frames wait out whole turns
+static const int PACER_TICK_MS = 1;
+static const size_t PACER_SLOTS = 4096;
+// Frames scheduled per lock hold
+static const size_t SCHEDULE_CHUNK = 256;
+
+FramePacer::FramePacer(Sender sender)
+    : sender(sender), mutex(), wakeCv(), idleCv(), wheel(PACER_TICK_MS, PACER_SLOTS), waiting(), dueKeys(), nextKey(1),
+      inFlight(0), lateness(), failed(0), running(true), worker() {
+    worker = thread(&FramePacer::run, this);
+}
+
+FramePacer::~FramePacer() {
+    stop();
+}
+
+void FramePacer::stop() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wakeCv.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+void FramePacer::schedule(vector<OutgoingFrame> frames) {
+    TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+    // Soonest first and a chunk at a time, so the first frames can go out while the rest is being scheduled
+    stable_sort(frames.begin(), frames.end(),
+                [](const OutgoingFrame &a, const OutgoingFrame &b) { return max(a.sendAfterMs, 0) < max(b.sendAfterMs, 0); });
+    for (size_t begin = 0; begin < frames.size(); begin += SCHEDULE_CHUNK) {
+        {
+            lock_guard<std::mutex> lock(mutex);
+            for (size_t i = begin; i < min(begin + SCHEDULE_CHUNK, frames.size()); i++) {
+                int delayMs = max(frames[i].sendAfterMs, 0);
+                TimerWheel::Clock::time_point due = now + chrono::milliseconds(delayMs);
+                // The wheel counts from when it is called, later than now once this call has run a while
+                int wheelDelayMs = max(0, static_cast<int>(chrono::duration_cast<chrono::milliseconds>(due - TimerWheel::Clock::now()).count()));
+                unsigned long key = nextKey++;
+                auto entry = waiting.insert(make_pair(key, Scheduled(std::move(frames[i]), due))).first;
+                entry->second.timerId = wheel.schedule(wheelDelayMs, [this, key]() { dueKeys.push_back(key); });
+            }
+        }
+        wakeCv.notify_all();
+    }
+}
+
+vector<OutgoingFrame> FramePacer::cancelAll() {
+    vector<OutgoingFrame> cancelled;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        for (auto &entry : waiting) {
+            wheel.cancel(entry.second.timerId);
+            cancelled.push_back(entry.second.frame);
+        }
+        waiting.clear();
+        lateness.clear();
+        failed = 0;
+    }
+    idleCv.notify_all();
+    return cancelled;
+}
+
+void FramePacer::waitIdle() {
+    unique_lock<std::mutex> lock(mutex);
+    idleCv.wait(lock, [this]() { return (waiting.empty() && inFlight == 0) || !running; });
+}
+
+size_t FramePacer::pending() const {
+    lock_guard<std::mutex> lock(mutex);
+    return waiting.size() + inFlight;
+}
+
+void FramePacer::run() {
+    unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (wheel.size() == 0) {
+            wakeCv.wait(lock, [this]() { return !running || wheel.size() > 0; });
+            continue;
+        }
+        wakeCv.wait_until(lock, wheel.nextTickAt());
+        if (!running) break;
+
+        // The callbacks only collect keys, so they can run under the lock
+        for (auto &callback : wheel.advance(TimerWheel::Clock::now())) callback();
+        vector<Scheduled> due;
+        for (unsigned long key : dueKeys) {
+            auto entry = waiting.find(key);
+            if (entry == waiting.end()) continue;
+            due.push_back(entry->second);
+            waiting.erase(entry);
+        }
+        dueKeys.clear();
+        if (due.empty()) continue;
+        inFlight += due.size();
+
+        lock.unlock();
+        vector<double> late;
+        size_t refused = 0;
+        for (const Scheduled &item : due) {
+            // The wheel rounds to whole ticks and may fire up to a tick early; the rest is slept off here
+            this_thread::sleep_until(item.due);
+            late.push_back(chrono::duration<double, micro>(TimerWheel::Clock::now() - item.due).count());
+            if (!sender(item.frame)) refused++;
+        }
+        lock.lock();
+
+        inFlight -= due.size();
+        lateness.insert(lateness.end(), late.begin(), late.end());
+        failed += refused;
+        if (waiting.empty() && inFlight == 0) {
+            printRun();
+            idleCv.notify_all();
+        }
+    }
+    idleCv.notify_all();
+}
+
+// Called with the lock held once the last scheduled frame is out
+void FramePacer::printRun() {
+    if (lateness.empty()) return;
+    sort(lateness.begin(), lateness.end());
+    cout << "Replay finished: " << lateness.size() - failed << " events sent" << (failed ? ", " + to_string(failed) + " lost" : "")
+         << ", late by p50 " << lateness[lateness.size() / 2] / 1000 << " ms, p99 " << lateness[lateness.size() * 99 / 100] / 1000
+         << " ms, max " << lateness.back() / 1000 << " ms" << endl;
+    lateness.clear();
+    failed = 0;
+}
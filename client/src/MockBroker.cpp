@@ -0,0 +1,206 @@
+#include "../include/MockBroker.h"
+#include "../include/StompFrame.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Replayed frames are gathered into writes of about this size
+static const size_t WRITE_BATCH = 64 * 1024;
+
+MockBroker::MockBroker()
+    : serverFd(-1), clientFd(-1), reader(), writer(), mutex(), changed(), running(false), replies(), script(),
+      scriptPos(0), scriptWritten(0), scriptBase(0), rate(0), scriptStart(), subscriptions(), framesIn(0), framesOut(0),
+      bytesOut(0), arena() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0) {
+        cerr << "socketpair failed: " << strerror(errno) << endl;
+        return;
+    }
+    serverFd = fds[0];
+    clientFd = fds[1];
+}
+
+MockBroker::~MockBroker() {
+    stop();
+    if (clientFd >= 0) close(clientFd);
+}
+
+int MockBroker::takeClientFd() {
+    int fd = clientFd;
+    clientFd = -1;
+    return fd;
+}
+
+void MockBroker::start() {
+    if (serverFd < 0) return;
+    running = true;
+    reader = thread(&MockBroker::readLoop, this);
+    writer = thread(&MockBroker::writeLoop, this);
+}
+
+void MockBroker::stop() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    changed.notify_all();
+    // Wakes the reader out of recv
+    if (serverFd >= 0) shutdown(serverFd, SHUT_RDWR);
+    if (reader.joinable()) reader.join();
+    if (writer.joinable()) writer.join();
+    if (serverFd >= 0) close(serverFd);
+    serverFd = -1;
+}
+
+void MockBroker::replay(const vector<string> &frames, double framesPerSecond) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (scriptWritten == script.size()) {
+            script.clear();
+            scriptPos = 0;
+            scriptWritten = 0;
+        }
+        scriptBase = scriptPos;
+        scriptStart = Clock::now();
+        rate = framesPerSecond;
+        script.insert(script.end(), frames.begin(), frames.end());
+    }
+    changed.notify_all();
+}
+
+void MockBroker::waitReplayed() {
+    unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return !running || scriptWritten == script.size(); });
+}
+
+int MockBroker::waitForSubscription(const string &destination, int timeoutMs) {
+    unique_lock<std::mutex> lock(mutex);
+    bool found = changed.wait_for(lock, chrono::milliseconds(timeoutMs),
+                                  [this, &destination]() { return subscriptions.count(destination) > 0; });
+    return found ? subscriptions[destination] : -1;
+}
+
+MockBrokerStats MockBroker::stats() const {
+    MockBrokerStats s;
+    s.framesIn = framesIn;
+    s.framesOut = framesOut;
+    s.bytesOut = bytesOut;
+    return s;
+}
+
+void MockBroker::readLoop() {
+    string in;
+    char buffer[16 * 1024];
+    while (true) {
+        ssize_t got = recv(serverFd, buffer, sizeof(buffer), 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        in.append(buffer, got);
+
+        size_t start = 0;
+        while (true) {
+            // Heart-beats between frames
+            while (start < in.size() && (in[start] == '\n' || in[start] == '\r')) start++;
+            size_t end = in.find('\0', start);
+            if (end == string::npos) break;
+            handle(in.substr(start, end - start));
+            start = end + 1;
+        }
+        in.erase(0, start);
+    }
+    // The client is gone, nothing more can be written
+    {
+        lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    changed.notify_all();
+}
+
+void MockBroker::handle(const string &data) {
+    arena.reset();
+    FrameView frame;
+    if (!parseFrame(data, arena, frame)) return;
+    framesIn++;
+
+    string command = frame.command.str();
+    {
+        lock_guard<std::mutex> lock(mutex);
+        if (command == "CONNECT") {
+            replies.push_back("CONNECTED\nversion:1.2\nheart-beat:0,0\n");
+        } else if (command == "SUBSCRIBE") {
+            subscriptions[frame.headerOr("destination", "")] = atoi(frame.headerOr("id", "-1").c_str());
+        } else if (command == "UNSUBSCRIBE") {
+            int id = atoi(frame.headerOr("id", "-1").c_str());
+            for (auto it = subscriptions.begin(); it != subscriptions.end(); ++it) {
+                if (it->second == id) {
+                    subscriptions.erase(it);
+                    break;
+                }
+            }
+        }
+        if (const StrView *receipt = frame.header("receipt")) {
+            replies.push_back("RECEIPT\nreceipt-id:" + receipt->str() + "\n");
+        }
+    }
+    changed.notify_all();
+}
+
+void MockBroker::writeLoop() {
+    unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        string out;
+        size_t frames = 0;
+        while (!replies.empty()) {
+            out += replies.front();
+            out += '\0';
+            replies.pop_front();
+            frames++;
+        }
+        size_t replayed = 0;
+        Clock::time_point nextDue = Clock::time_point::max();
+        Clock::time_point now = Clock::now();
+        while (scriptPos < script.size() && out.size() < WRITE_BATCH) {
+            if (rate > 0) {
+                Clock::time_point due = scriptStart + chrono::duration_cast<Clock::duration>(
+                                                          chrono::duration<double>((scriptPos - scriptBase) / rate));
+                if (due > now) {
+                    nextDue = due;
+                    break;
+                }
+            }
+            out += script[scriptPos++];
+            out += '\0';
+            replayed++;
+        }
+
+        if (out.empty()) {
+            if (nextDue == Clock::time_point::max()) changed.wait(lock);
+            else changed.wait_until(lock, nextDue);
+            continue;
+        }
+
+        lock.unlock();
+        size_t sent = 0;
+        while (sent < out.size()) {
+            ssize_t n = send(serverFd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            sent += n;
+        }
+        lock.lock();
+
+        if (sent < out.size()) {
+            running = false;
+        } else {
+            framesOut += frames + replayed;
+            bytesOut += out.size();
+            scriptWritten += replayed;
+        }
+        changed.notify_all();
+    }
+}
@@ -0,0 +1,165 @@
+#include "../include/ReceiptManager.h"
+#include <vector>
+
+using namespace std;
+
+ReceiptManager::ReceiptManager(int tickMs)
+    : mutex(), tickCv(), pending(), wheel(tickMs, 512), running(true), ticker() {
+    ticker = thread(&ReceiptManager::tickLoop, this);
+}
+
+ReceiptManager::~ReceiptManager() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    tickCv.notify_all();
+    if (ticker.joinable()) ticker.join();
+    cancelAll();
+}
+
+shared_future<bool> ReceiptManager::expect(int receiptId, const string &action, int timeoutMs, Callback callback, bool armNow) {
+    Pending entry;
+    entry.action = action;
+    entry.timeoutMs = timeoutMs;
+    entry.armed = armNow;
+    entry.sentAt = TimerWheel::Clock::now();
+    entry.promise = make_shared<promise<bool>>();
+    entry.callback = callback;
+    shared_future<bool> future = entry.promise->get_future().share();
+
+    {
+        lock_guard<std::mutex> lock(mutex);
+        entry.timerId = armNow && timeoutMs > 0 ? wheel.schedule(timeoutMs, [this, receiptId]() { expire(receiptId); }) : 0;
+        pending[receiptId] = entry;
+    }
+    tickCv.notify_all();
+    return future;
+}
+
+bool ReceiptManager::complete(int receiptId, string &action) {
+    Pending entry;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(receiptId);
+        if (it == pending.end()) return false;
+        entry = it->second;
+        pending.erase(it);
+        if (entry.timerId != 0) wheel.cancel(entry.timerId);
+    }
+
+    action = entry.action;
+    long rtt = chrono::duration_cast<chrono::microseconds>(TimerWheel::Clock::now() - entry.sentAt).count();
+    entry.promise->set_value(true);
+    if (entry.callback) entry.callback(true, rtt);
+    return true;
+}
+
+bool ReceiptManager::isPending(int receiptId) const {
+    lock_guard<std::mutex> lock(mutex);
+    return pending.count(receiptId) > 0;
+}
+
+size_t ReceiptManager::pendingCount() const {
+    lock_guard<std::mutex> lock(mutex);
+    return pending.size();
+}
+
+map<int, pair<string, long>> ReceiptManager::snapshot() const {
+    lock_guard<std::mutex> lock(mutex);
+    map<int, pair<string, long>> result;
+    TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+    for (auto const& entry : pending) {
+        long age = chrono::duration_cast<chrono::milliseconds>(now - entry.second.sentAt).count();
+        result[entry.first] = make_pair(entry.second.action, age);
+    }
+    return result;
+}
+
+void ReceiptManager::restart(int receiptId) {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(receiptId);
+        if (it == pending.end()) return;
+        restartLocked(receiptId, it->second, TimerWheel::Clock::now());
+    }
+    tickCv.notify_all();
+}
+
+void ReceiptManager::rearm() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        TimerWheel::Clock::time_point now = TimerWheel::Clock::now();
+        for (auto& entry : pending) {
+            if (entry.second.armed) restartLocked(entry.first, entry.second, now);
+        }
+    }
+    tickCv.notify_all();
+}
+
+void ReceiptManager::restartLocked(int receiptId, Pending &entry, TimerWheel::Clock::time_point now) {
+    if (entry.timerId != 0) wheel.cancel(entry.timerId);
+    entry.armed = true;
+    entry.sentAt = now;
+    entry.timerId = entry.timeoutMs > 0 ? wheel.schedule(entry.timeoutMs, [this, receiptId]() { expire(receiptId); }) : 0;
+}
+
+void ReceiptManager::cancel(int receiptId) {
+    Pending entry;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(receiptId);
+        if (it == pending.end()) return;
+        entry = it->second;
+        pending.erase(it);
+        if (entry.timerId != 0) wheel.cancel(entry.timerId);
+    }
+    entry.promise->set_value(false);
+}
+
+void ReceiptManager::cancelAll() {
+    map<int, Pending> failed;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        for (auto const& entry : pending) {
+            if (entry.second.timerId != 0) wheel.cancel(entry.second.timerId);
+        }
+        failed.swap(pending);
+    }
+    for (auto& entry : failed) {
+        entry.second.promise->set_value(false);
+        if (entry.second.callback) entry.second.callback(false, 0);
+    }
+}
+
+void ReceiptManager::expire(int receiptId) {
+    Pending entry;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(receiptId);
+        if (it == pending.end()) return;
+        entry = it->second;
+        pending.erase(it);
+    }
+    long age = chrono::duration_cast<chrono::microseconds>(TimerWheel::Clock::now() - entry.sentAt).count();
+    entry.promise->set_value(false);
+    if (entry.callback) entry.callback(false, age);
+}
+
+void ReceiptManager::tickLoop() {
+    unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        // Sleep until notified while nothing is armed, otherwise wake up once per tick
+        if (wheel.size() == 0) {
+            tickCv.wait(lock, [this]() { return !running || wheel.size() > 0; });
+        } else {
+            tickCv.wait_for(lock, chrono::milliseconds(wheel.getTickMs()));
+        }
+        if (!running) break;
+
+        vector<TimerWheel::Callback> due = wheel.advance(TimerWheel::Clock::now());
+        lock.unlock();
+        for (auto& callback : due) callback();
+        lock.lock();
+    }
+}
@@ -0,0 +1,235 @@
+#include "../include/ShmTransport.h"
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using std::string;
+
+// Polls before going to sleep; a round trip on the same host is usually shorter than this.
+// With a single CPU the other side cannot make progress while this one spins, so it sleeps at once.
+static const int SPIN_ITERATIONS = std::thread::hardware_concurrency() > 1 ? 4000 : 0;
+
+struct ShmTransport::Ring {
+    // Total bytes ever written and read; the data sits at position % RING_BYTES
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    // Futex words, bumped when the other side asked to be woken
+    alignas(64) std::atomic<uint32_t> dataSeq;
+    std::atomic<uint32_t> readerWaiting;
+    alignas(64) std::atomic<uint32_t> spaceSeq;
+    std::atomic<uint32_t> writerWaiting;
+    alignas(64) char data[RING_BYTES];
+};
+
+struct ShmTransport::Segment {
+    std::atomic<uint32_t> attached;     // futex word: 0 until the client maps the segment
+    std::atomic<uint32_t> closed;
+    Ring toServer;
+    Ring toClient;
+};
+
+static long futex(std::atomic<uint32_t> *word, int op, uint32_t value, const timespec *timeout) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, value, timeout, nullptr, 0);
+}
+
+static void wake(std::atomic<uint32_t> &seq) {
+    seq.fetch_add(1);
+    futex(&seq, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+// Waits until ready() or the timeout (0 waits forever). waiting/seq are the futex pair the other
+// side checks after it makes progress. Returns false on timeout.
+template <typename Ready>
+static bool waitFor(Ready ready, std::atomic<uint32_t> &waiting, std::atomic<uint32_t> &seq, int timeoutMs) {
+    for (int i = 0; i < SPIN_ITERATIONS; i++) {
+        if (ready())
+            return true;
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        uint32_t observed = seq.load();
+        waiting.store(1);
+        // Checked after announcing the wait: either this sees the progress or the other side sees waiting
+        if (ready()) {
+            waiting.store(0);
+            return true;
+        }
+        if (timeoutMs > 0) {
+            auto left = deadline - std::chrono::steady_clock::now();
+            if (left <= std::chrono::steady_clock::duration::zero()) {
+                waiting.store(0);
+                return false;
+            }
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+            timespec timeout;
+            timeout.tv_sec = ns / 1000000000;
+            timeout.tv_nsec = ns % 1000000000;
+            futex(&seq, FUTEX_WAIT, observed, &timeout);
+        } else {
+            futex(&seq, FUTEX_WAIT, observed, nullptr);
+        }
+        waiting.store(0);
+    }
+}
+
+ShmTransport::ShmTransport(const string &name, Role role)
+    : name_(name[0] == '/' ? name : "/" + name), role_(role), segment_(nullptr), in_(nullptr), out_(nullptr) {}
+
+ShmTransport::~ShmTransport() {
+    close();
+    unmap();
+}
+
+void ShmTransport::map(int fd, boost::system::error_code &error) {
+    void *memory = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        error = boost::system::error_code(errno, boost::system::system_category());
+        return;
+    }
+    segment_ = static_cast<Segment *>(memory);
+    in_ = role_ == SERVER ? &segment_->toServer : &segment_->toClient;
+    out_ = role_ == SERVER ? &segment_->toClient : &segment_->toServer;
+}
+
+void ShmTransport::unmap() {
+    if (!segment_)
+        return;
+    munmap(segment_, sizeof(Segment));
+    segment_ = nullptr;
+    in_ = nullptr;
+    out_ = nullptr;
+}
+
+void ShmTransport::connect(boost::system::error_code &error) {
+    close();
+    unmap();
+    error = boost::system::error_code();
+    if (role_ == CLIENT) {
+        int fd = shm_open(name_.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            error = boost::system::error_code(errno, boost::system::system_category());
+            return;
+        }
+        map(fd, error);
+        if (error)
+            return;
+        // A segment is served to one client at a time
+        uint32_t expected = 0;
+        if (!segment_->attached.compare_exchange_strong(expected, 1) || segment_->closed) {
+            unmap();
+            error = boost::asio::error::connection_refused;
+            return;
+        }
+        futex(&segment_->attached, FUTEX_WAKE, INT_MAX, nullptr);
+        return;
+    }
+
+    // A segment left behind by a server that died is replaced
+    shm_unlink(name_.c_str());
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 || ftruncate(fd, sizeof(Segment)) < 0) {
+        error = boost::system::error_code(errno, boost::system::system_category());
+        if (fd >= 0)
+            ::close(fd);
+        return;
+    }
+    // ftruncate zero-fills, which is the initial state of every counter
+    map(fd, error);
+    if (error)
+        return;
+    while (segment_->attached.load() == 0)
+        futex(&segment_->attached, FUTEX_WAIT, 0, nullptr);
+}
+
+size_t ShmTransport::readSome(char *buffer, size_t size, int timeoutMs, boost::system::error_code &error) {
+    error = boost::system::error_code();
+    if (!segment_) {
+        error = boost::asio::error::bad_descriptor;
+        return 0;
+    }
+    Ring &ring = *in_;
+    Segment &segment = *segment_;
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    bool ready = waitFor([&]() { return ring.head.load(std::memory_order_acquire) != tail || segment.closed.load(); },
+                         ring.readerWaiting, ring.dataSeq, timeoutMs);
+    if (!ready) {
+        error = boost::asio::error::timed_out;
+        return 0;
+    }
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+    if (head == tail) {
+        error = boost::asio::error::eof;
+        return 0;
+    }
+
+    size_t count = std::min<uint64_t>(size, head - tail);
+    size_t offset = tail % RING_BYTES;
+    size_t first = std::min(count, RING_BYTES - offset);
+    std::memcpy(buffer, ring.data + offset, first);
+    std::memcpy(buffer + first, ring.data, count - first);
+    ring.tail.store(tail + count);
+    if (ring.writerWaiting.load())
+        wake(ring.spaceSeq);
+    return count;
+}
+
+size_t ShmTransport::writeSome(const char *bytes, size_t size, boost::system::error_code &error) {
+    Ring &ring = *out_;
+    Segment &segment = *segment_;
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    waitFor([&]() { return head - ring.tail.load(std::memory_order_acquire) < RING_BYTES || segment.closed.load(); },
+            ring.writerWaiting, ring.spaceSeq, 0);
+    if (segment.closed.load()) {
+        error = boost::asio::error::broken_pipe;
+        return 0;
+    }
+
+    size_t count = std::min<uint64_t>(size, RING_BYTES - (head - ring.tail.load(std::memory_order_acquire)));
+    size_t offset = head % RING_BYTES;
+    size_t first = std::min(count, RING_BYTES - offset);
+    std::memcpy(ring.data + offset, bytes, first);
+    std::memcpy(ring.data, bytes + first, count - first);
+    ring.head.store(head + count);
+    if (ring.readerWaiting.load())
+        wake(ring.dataSeq);
+    return count;
+}
+
+void ShmTransport::write(const char *first, size_t firstSize, const char *second, size_t secondSize,
+                         boost::system::error_code &error) {
+    error = boost::system::error_code();
+    if (!segment_) {
+        error = boost::asio::error::bad_descriptor;
+        return;
+    }
+    for (size_t done = 0; done < firstSize && !error;)
+        done += writeSome(first + done, firstSize - done, error);
+    for (size_t done = 0; done < secondSize && !error;)
+        done += writeSome(second + done, secondSize - done, error);
+}
+
+// Wakes both sides; the mapping stays until the next connect() or destruction, so a thread still
+// blocked in readSome() returns eof instead of touching unmapped memory
+void ShmTransport::close() {
+    if (!segment_ || segment_->closed.exchange(1))
+        return;
+    wake(segment_->toServer.dataSeq);
+    wake(segment_->toServer.spaceSeq);
+    wake(segment_->toClient.dataSeq);
+    wake(segment_->toClient.spaceSeq);
+    if (role_ == SERVER)
+        shm_unlink(name_.c_str());
+}
+
+string ShmTransport::describe() const {
+    return "shm:" + name_.substr(1);
+}
@@ -0,0 +1,78 @@
+#include "../include/SocketTuning.h"
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+using std::string;
+using std::vector;
+
+static vector<SocketProfile> buildProfiles() {
+    vector<SocketProfile> profiles(3);
+    profiles[1].name = "low-latency";
+    profiles[1].noDelay = true;
+    profiles[1].quickAck = true;
+    profiles[1].busyPollUs = 50;
+
+    profiles[2].name = "bulk";
+    // Corking does the batching, so Nagle would only delay the last packet of a command
+    profiles[2].noDelay = true;
+    profiles[2].sendBuffer = 4 * 1024 * 1024;
+    profiles[2].receiveBuffer = 4 * 1024 * 1024;
+    profiles[2].corkBatches = true;
+    return profiles;
+}
+
+static const vector<SocketProfile> &profiles() {
+    static const vector<SocketProfile> all = buildProfiles();
+    return all;
+}
+
+bool findSocketProfile(const string &name, SocketProfile &out) {
+    for (const SocketProfile &profile : profiles()) {
+        if (profile.name == name) {
+            out = profile;
+            return true;
+        }
+    }
+    return false;
+}
+
+vector<string> socketProfileNames() {
+    vector<string> names;
+    for (const SocketProfile &profile : profiles())
+        names.push_back(profile.name);
+    return names;
+}
+
+static void setOption(int fd, int level, int option, int value, const char *name, vector<string> &refused) {
+    if (setsockopt(fd, level, option, &value, sizeof(value)) < 0)
+        refused.push_back(string(name) + ": " + strerror(errno));
+}
+
+vector<string> applySocketProfile(int fd, const SocketProfile &profile, bool tcp) {
+    vector<string> refused;
+    // Options are set both ways, so switching profiles on a reused socket takes the old ones off
+    if (tcp) {
+        setOption(fd, IPPROTO_TCP, TCP_NODELAY, profile.noDelay, "TCP_NODELAY", refused);
+        setOption(fd, IPPROTO_TCP, TCP_QUICKACK, profile.quickAck, "TCP_QUICKACK", refused);
+    }
+    if (profile.sendBuffer > 0)
+        setOption(fd, SOL_SOCKET, SO_SNDBUF, profile.sendBuffer, "SO_SNDBUF", refused);
+    if (profile.receiveBuffer > 0)
+        setOption(fd, SOL_SOCKET, SO_RCVBUF, profile.receiveBuffer, "SO_RCVBUF", refused);
+    if (profile.busyPollUs > 0)
+        setOption(fd, SOL_SOCKET, SO_BUSY_POLL, profile.busyPollUs, "SO_BUSY_POLL", refused);
+    return refused;
+}
+
+void setCork(int fd, bool on) {
+    int value = on;
+    setsockopt(fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+}
+
+void rearmQuickAck(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+}
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/event.h"
+#include "../include/BodyCodec.h"
+#include "../include/StompFrame.h"
+#include "../include/StructuralIndex.h"
+#include "../include/EventLoader.h"
+#include "../include/json.hpp"
+#include "../include/ConnectionHandler.h"
+#include "../include/MockBroker.h"
+#include "../include/StompProtocol.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// Parser throughput on MESSAGE frames and on an events file grown from a real one, the body codec on
+// the sample event files, then the whole receive path against the in-process mock broker, replaying
+// at a rate (frames/s, 0 for unpaced):
+//   StompBench [events file] [MB to scan per run] [replay rate]
+
+static const int RUNS = 5;
+static const char *const SAMPLE_DIR = "data";
+
+static void appendSection(string &body, const string &title, const map<string, string> &updates) {
+    body += title + "\n";
+    for (auto const &update : updates) body += update.first + ": " + update.second + "\n";
+}
+
+// Same layout StompProtocol sends reports in
+static string buildBody(const Event &event, int time) {
+    string body = "user: bench\n";
+    body += "team a: " + event.get_team_a_name() + "\n";
+    body += "team b: " + event.get_team_b_name() + "\n";
+    body += "event name: " + event.get_name() + "\n";
+    body += "time: " + to_string(time) + "\n";
+    appendSection(body, "general game updates:", event.get_game_updates());
+    appendSection(body, "team a updates:", event.get_team_a_updates());
+    appendSection(body, "team b updates:", event.get_team_b_updates());
+    body += "description:\n" + event.get_discription();
+    return body;
+}
+
+// A report as the server delivers it
+static string buildMessage(const Event &event, size_t messageId, int subscriptionId, int time) {
+    string body = buildBody(event, time);
+    return "MESSAGE\nsubscription:" + to_string(subscriptionId) + "\nmessage-id:" + to_string(messageId) + "\ndestination:/" +
+           event.get_team_a_name() + "_" + event.get_team_b_name() + "\n\n" + body;
+}
+
+static double gbPerSecond(size_t bytes, Clock::duration elapsed) {
+    double seconds = chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? bytes / seconds / 1e9 : 0;
+}
+
+// The events of file repeated into one events file of about targetBytes
+static string growEventsFile(const string &file, size_t targetBytes) {
+    ifstream in(file);
+    nlohmann::json doc = nlohmann::json::parse(in);
+    nlohmann::json events = doc["events"];
+    string one = events.dump(4);
+    doc["events"] = nlohmann::json::array();
+    for (size_t copies = 0; copies * one.size() < targetBytes; copies++) {
+        for (auto &event : events) doc["events"].push_back(event);
+    }
+    return doc.dump(4);
+}
+
+// Bandwidth the body codec saves against what it costs, per sample event file: report bodies are encoded
+// the way 'compress on' sends them and decoded the way a subscriber receives them
+static void benchCodec() {
+    vector<string> files;
+    DIR *dir = opendir(SAMPLE_DIR);
+    if (!dir) {
+        cout << "codec: no " << SAMPLE_DIR << " directory" << endl;
+        return;
+    }
+    while (struct dirent *entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0) files.push_back(string(SAMPLE_DIR) + "/" + name);
+    }
+    closedir(dir);
+    sort(files.begin(), files.end());
+
+    BodyCodec codec;
+    for (const string &file : files) {
+        vector<string> bodies;
+        size_t plainBytes = 0;
+        try {
+            for (const Event &event : parseEventsFile(file).events) {
+                bodies.push_back(buildBody(event, event.get_time()));
+                plainBytes += bodies.back().size();
+            }
+        } catch (...) {
+            cout << "codec " << file << ": cannot parse" << endl;
+            continue;
+        }
+        if (bodies.empty()) continue;
+
+        // Each run goes over the file many times, its few events alone are too quick to time
+        const size_t passes = 1000;
+        vector<string> encoded(bodies.size());
+        string decoded;
+        size_t encodedBytes = 0;
+        bool roundTrips = true;
+        Clock::duration bestEncode = Clock::duration::max(), bestDecode = Clock::duration::max();
+        for (int run = 0; run < RUNS; run++) {
+            auto start = Clock::now();
+            for (size_t pass = 0; pass < passes; pass++) {
+                for (size_t i = 0; i < bodies.size(); i++) encoded[i] = codec.encode(bodies[i]);
+            }
+            bestEncode = min(bestEncode, Clock::now() - start);
+
+            start = Clock::now();
+            for (size_t pass = 0; pass < passes; pass++) {
+                for (size_t i = 0; i < encoded.size(); i++) {
+                    roundTrips = codec.decode(encoded[i], decoded) && roundTrips;
+                }
+            }
+            bestDecode = min(bestDecode, Clock::now() - start);
+        }
+        for (size_t i = 0; i < bodies.size(); i++) {
+            encodedBytes += encoded[i].size();
+            roundTrips = roundTrips && codec.decode(encoded[i], decoded) && decoded == bodies[i];
+        }
+
+        double frames = static_cast<double>(passes * bodies.size());
+        cout << "codec " << file << ": " << bodies.size() << " bodies, " << plainBytes << " -> " << encodedBytes << " bytes ("
+             << 100 - 100 * encodedBytes / plainBytes << "% saved), encode " << chrono::duration<double, nano>(bestEncode).count() / frames
+             << " ns/frame, decode " << chrono::duration<double, nano>(bestDecode).count() / frames << " ns/frame"
+             << (roundTrips ? "" : ", ROUND TRIP FAILED") << endl;
+    }
+}
+
+static void benchEventsFile(const string &file, size_t targetBytes) {
+    string text = growEventsFile(file, targetBytes);
+    cout << "events file: " << text.size() / (1024 * 1024) << " MB" << endl;
+
+    vector<uint32_t> positions;
+    for (ScanKernel kernel : {ScanKernel::SCALAR, ScanKernel::SSE2, ScanKernel::AVX2}) {
+        if (!scanKernelSupported(kernel)) continue;
+        Clock::duration best = Clock::duration::max();
+        for (int run = 0; run < RUNS; run++) {
+            auto start = Clock::now();
+            indexJson(kernel, text, positions);
+            best = min(best, Clock::now() - start);
+        }
+        cout << "json index " << scanKernelName(kernel) << ": " << gbPerSecond(text.size(), best) << " GB/s ("
+             << positions.size() << " structurals)" << endl;
+    }
+
+    names_and_events loaded;
+    auto start = Clock::now();
+    bool fast = parseEventsFast(text, loaded);
+    Clock::duration fastTime = Clock::now() - start;
+    cout << "json load fast path: " << (fast ? "" : "rejected, ") << gbPerSecond(text.size(), fastTime) << " GB/s, "
+         << loaded.events.size() << " events" << endl;
+
+    start = Clock::now();
+    nlohmann::json doc = nlohmann::json::parse(text);
+    Clock::duration treeTime = Clock::now() - start;
+    cout << "json load nlohmann (tree only): " << gbPerSecond(text.size(), treeTime) << " GB/s" << endl;
+}
+
+// Sends what the client would for a line of user input
+static bool sendInput(StompProtocol &protocol, ConnectionHandler &handler, const string &line) {
+    for (const OutgoingFrame &frame : protocol.processUserInput(line)) {
+        protocol.waitToSend(frame);
+        if (!handler.sendFrameAscii(frame.frame, '\0')) return false;
+    }
+    return true;
+}
+
+// MESSAGE frames from the mock broker through ConnectionHandler and StompProtocol, the way the
+// client's listener thread reads them. No server process involved.
+static void benchLoopback(const names_and_events &data, size_t frameCount, double rate) {
+    MockBroker broker;
+    ConnectionHandler handler("loopback", 0);
+    if (!handler.attach(broker.takeClientFd())) return;
+    broker.start();
+
+    // Every game update is printed; the terminal is not what is measured here
+    ostringstream discard;
+    streambuf *console = cout.rdbuf(discard.rdbuf());
+
+    StompProtocol protocol;
+    atomic<size_t> messages(0);
+    thread listener([&]() {
+        string frame;
+        while (handler.getFrameAscii(frame, '\0')) {
+            bool isMessage = frame.compare(0, 7, "MESSAGE") == 0;
+            protocol.processServerFrame(frame);
+            if (isMessage) messages++;
+            frame.clear();
+        }
+    });
+
+    string game = data.team_a_name + "_" + data.team_b_name;
+    int subscription = -1;
+    if (sendInput(protocol, handler, "login loopback:0 bench bench")) {
+        for (int waited = 0; !protocol.getIsConnected() && waited < 5000; waited++) this_thread::sleep_for(chrono::milliseconds(1));
+        if (protocol.getIsConnected() && sendInput(protocol, handler, "join " + game)) {
+            subscription = broker.waitForSubscription("/" + game, 5000);
+        }
+    }
+
+    Clock::duration elapsed = Clock::duration::zero();
+    size_t bytes = 0;
+    if (subscription >= 0) {
+        vector<string> frames;
+        for (size_t i = 0; i < frameCount; i++) {
+            const Event &event = data.events[i % data.events.size()];
+            // Distinct times, so the client's dedup window keeps every event
+            frames.push_back(buildMessage(event, i, subscription, static_cast<int>(i)));
+            bytes += frames.back().size() + 1;
+        }
+        auto start = Clock::now();
+        broker.replay(frames, rate);
+        while (messages < frameCount) this_thread::sleep_for(chrono::microseconds(100));
+        elapsed = Clock::now() - start;
+    }
+
+    handler.close();
+    broker.stop();
+    listener.join();
+    cout.rdbuf(console);
+
+    if (subscription < 0) {
+        cout << "loopback: the client did not log in and subscribe" << endl;
+        return;
+    }
+    double seconds = chrono::duration<double>(elapsed).count();
+    cout << "loopback receive path (" << (rate > 0 ? to_string(static_cast<long>(rate)) + " frames/s offered" : "unpaced")
+         << "): " << static_cast<long>(seconds > 0 ? frameCount / seconds : 0) << " frames/s, "
+         << gbPerSecond(bytes, elapsed) * 1000 << " MB/s" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    string file = argc > 1 ? argv[1] : "data/events1.json";
+    size_t targetBytes = (argc > 2 ? stoul(argv[2]) : 64) * 1024 * 1024;
+    double rate = argc > 3 ? stod(argv[3]) : 0;
+
+    names_and_events data;
+    try {
+        data = parseEventsFile(file);
+    } catch (...) {
+        cerr << "Error parsing file " << file << endl;
+        return 1;
+    }
+    if (data.events.empty()) {
+        cerr << "No events in " << file << endl;
+        return 1;
+    }
+
+    vector<string> frames;
+    size_t frameBytes = 0;
+    for (size_t i = 0; frameBytes < targetBytes; i++) {
+        const Event &event = data.events[i % data.events.size()];
+        frames.push_back(buildMessage(event, i, 0, event.get_time()));
+        frameBytes += frames.back().size();
+    }
+    cout << frames.size() << " frames, " << frameBytes / frames.size() << " bytes on average, "
+         << frameBytes / (1024 * 1024) << " MB per run" << endl;
+
+    // Structural scan alone, over each frame the way the parser calls it
+    vector<uint32_t> positions;
+    for (ScanKernel kernel : {ScanKernel::SCALAR, ScanKernel::SSE2, ScanKernel::AVX2}) {
+        if (!scanKernelSupported(kernel)) {
+            cout << "scan " << scanKernelName(kernel) << ": not supported" << endl;
+            continue;
+        }
+        size_t found = 0;
+        Clock::duration best = Clock::duration::max();
+        for (int run = 0; run < RUNS; run++) {
+            auto start = Clock::now();
+            for (auto const &frame : frames) {
+                if (positions.size() < frame.size()) positions.resize(frame.size());
+                found += scanStructural(kernel, frame.data(), frame.size(), positions.data());
+            }
+            best = min(best, Clock::now() - start);
+        }
+        cout << "scan " << scanKernelName(kernel) << ": " << gbPerSecond(frameBytes, best) << " GB/s ("
+             << found / RUNS / frames.size() << " delimiters per frame)" << endl;
+    }
+
+    // Full receive path: frame headers, then the event body through the same index
+    FrameArena arena;
+    size_t stats = 0;
+    Clock::duration best = Clock::duration::max();
+    for (int run = 0; run < RUNS; run++) {
+        auto start = Clock::now();
+        for (auto const &frame : frames) {
+            arena.reset();
+            FrameView view;
+            if (!parseFrame(frame, arena, view)) continue;
+            EventView event = EventView::parse(view.body, view.index, arena);
+            stats += event.statCount;
+        }
+        best = min(best, Clock::now() - start);
+    }
+    double seconds = chrono::duration<double>(best).count();
+    cout << "parse (" << scanKernelName(bestScanKernel()) << "): " << gbPerSecond(frameBytes, best) << " GB/s, "
+         << static_cast<long>(seconds > 0 ? frames.size() / seconds : 0) << " frames/s ("
+         << stats / RUNS / frames.size() << " stats per event)" << endl;
+
+    benchEventsFile(file, targetBytes);
+    benchCodec();
+    benchLoopback(data, frames.size(), rate);
+    return 0;
+}
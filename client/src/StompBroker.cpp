@@ -0,0 +1,41 @@
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "../include/Broker.h"
+
+using namespace std;
+
+// Native broker for load tests and CI, speaks the same protocol as the Java server:
+//   StompBroker <port> [threads] [unix socket path]
+// Prints throughput every few seconds while there is traffic.
+
+static const int REPORT_SECONDS = 5;
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <port> [threads] [unix socket path]" << endl;
+        return 1;
+    }
+    unsigned short port = static_cast<unsigned short>(stoi(argv[1]));
+    size_t threads = argc > 2 ? stoul(argv[2]) : 0;
+
+    signal(SIGPIPE, SIG_IGN);
+    Broker broker(threads);
+    if (!broker.listen(port)) return 1;
+    if (argc > 3 && !broker.listenUnix(argv[3])) return 1;
+    broker.start();
+    cout << "StompBroker listening on port " << port << (argc > 3 ? string(" and ") + argv[3] : "") << endl;
+
+    BrokerStats last = broker.stats();
+    while (true) {
+        this_thread::sleep_for(chrono::seconds(REPORT_SECONDS));
+        BrokerStats now = broker.stats();
+        if (now.framesIn == last.framesIn && now.connections == last.connections) continue;
+        cout << (now.framesIn - last.framesIn) / REPORT_SECONDS << " frames/s in, "
+             << (now.messagesOut - last.messagesOut) / REPORT_SECONDS << " messages/s out, "
+             << now.connections << " connections so far" << endl;
+        last = now;
+    }
+}
@@ -1,24 +1,116 @@
 #include <stdlib.h>
 #include <ConnectionHandler.h> 
+#include <atomic>
 #include <thread>
+#include <chrono>
 #include <iostream>
+#include <fstream>
+#include <future>
 #include <vector>
+#include <algorithm>
 #include "StompProtocol.h"
+#include "FrameCapture.h"
+#include "FramePacer.h"
 
 using namespace std;
 
-void serverListener(ConnectionHandler* handler, StompProtocol* protocol, bool* shouldTerminate) {
+// Reconnect backoff: starts at INITIAL_BACKOFF_MS and doubles up to MAX_BACKOFF_MS
+const int INITIAL_BACKOFF_MS = 250;
+const int MAX_BACKOFF_MS = 10000;
+const int MAX_RECONNECT_ATTEMPTS = 15;
+
+// Messages of client / client-individual subscriptions are acknowledged at least this often
+const int ACK_FLUSH_MS = 200;
+
+// Batch mode waits this long for the answer to login before going on with the next command
+const int LOGIN_TIMEOUT_MS = 10000;
+
+// What main and the helper threads share for one run of the client
+struct ClientSession {
+    StompProtocol protocol;
+    // Set by the listener and the input thread, polled by every thread of the session
+    std::atomic<bool> shouldTerminate;
+    ConnectionHandler* handler;
+    thread* listenerThread;
+    thread* ackThread;
+    // Frames received while the capture command is on, for StompReplay
+    FrameCaptureWriter capture;
+    // Writes the frames of the replay command at their game time
+    FramePacer pacer;
+
+    ClientSession()
+        : protocol(), shouldTerminate(false), handler(nullptr), listenerThread(nullptr), ackThread(nullptr), capture(),
+          pacer([this](const OutgoingFrame& frame) {
+              if (shouldTerminate || !handler) {
+                  protocol.dropFrame(frame);
+                  return false;
+              }
+              protocol.waitToSend(frame);
+              if (!handler->sendFrameAscii(frame.frame, '\0')) {
+                  protocol.dropFrame(frame);
+                  return false;
+              }
+              protocol.frameSent(frame);
+              return true;
+          }) {}
+    ClientSession(const ClientSession&) = delete;
+    ClientSession& operator=(const ClientSession&) = delete;
+};
+
+void sendAcks(ConnectionHandler* handler, const vector<OutgoingFrame>& frames) {
+    for (const OutgoingFrame& ack : frames) {
+        if (!handler->sendFrameAscii(ack.frame, '\0')) break;
+    }
+}
+
+// Flushes acknowledgements that did not reach the batch size on their own
+void ackFlusher(ConnectionHandler* handler, StompProtocol* protocol, std::atomic<bool>* shouldTerminate) {
+    while (!(*shouldTerminate)) {
+        this_thread::sleep_for(chrono::milliseconds(ACK_FLUSH_MS));
+        sendAcks(handler, protocol->takeAckFrames(true));
+    }
+}
+
+// Reconnects with exponential backoff and resumes the session (login, subscriptions, pending receipts).
+// Returns false when giving up.
+bool reconnect(ConnectionHandler* handler, StompProtocol* protocol, std::atomic<bool>* shouldTerminate) {
+    int delayMs = INITIAL_BACKOFF_MS;
+    for (int attempt = 1; attempt <= MAX_RECONNECT_ATTEMPTS && !(*shouldTerminate); attempt++) {
+        cout << "Connection lost, reconnecting in " << delayMs << "ms (attempt " << attempt << ")" << endl;
+        this_thread::sleep_for(chrono::milliseconds(delayMs));
+        if (handler->reconnect(protocol->buildResumeFrames())) {
+            cout << "Reconnected to server" << endl;
+            return true;
+        }
+        delayMs = min(delayMs * 2, MAX_BACKOFF_MS);
+    }
+    return false;
+}
+
+void serverListener(ConnectionHandler* handler, StompProtocol* protocol, FrameCaptureWriter* capture, std::atomic<bool>* shouldTerminate) {
     while (!(*shouldTerminate)) {
         string frame;
         
         // Use getFrameAscii which reads until the null delimiter
         if (!handler->getFrameAscii(frame, '\0')) {
-             cout << "Disconnected from server." << endl;
-             *shouldTerminate = true;
-             break;
+            // Only a live session is worth resuming, a rejected login ends with an ERROR frame instead
+            if (!(*shouldTerminate) && protocol->getIsConnected() && reconnect(handler, protocol, shouldTerminate)) {
+                continue;
+            }
+            cout << "Disconnected from server." << endl;
+            *shouldTerminate = true;
+            break;
         }
 
+        capture->record(frame);
         bool terminate = protocol->processServerFrame(frame);
+        sendAcks(handler, protocol->takeAckFrames(false));
+
+        int sendEveryMs, receiveTimeoutMs;
+        if (protocol->takeHeartbeat(sendEveryMs, receiveTimeoutMs)) {
+            handler->setReadTimeout(receiveTimeoutMs);
+            handler->startHeartbeat(sendEveryMs);
+        }
         if (terminate) {
             *shouldTerminate = true;
             handler->close();
@@ -26,79 +118,212 @@ void serverListener(ConnectionHandler* handler, StompProtocol* protocol, bool* s
     }
 }
 
+void handleCapture(ClientSession& session, const string& line) {
+    stringstream ss(line);
+    string cmd, path;
+    ss >> cmd >> path;
+    if (path.empty()) {
+        cout << "Usage: capture {file}|off" << endl;
+    } else if (path == "off") {
+        cout << "Captured " << session.capture.stop() << " frames" << endl;
+    } else if (session.capture.start(path)) {
+        cout << "Capturing received frames to " << path << endl;
+    } else {
+        cout << "Could not create " << path << endl;
+    }
+}
+
+// Connects and sends CONNECT. In batch mode, also waits for the server's answer so the next command finds the session up.
+void handleLogin(ClientSession& session, const string& line, bool batch) {
+    if (session.protocol.getIsConnected()) {
+        cout << "The client is already logged in, log out before trying again" << endl;
+        return;
+    }
+    
+    stringstream ss(line);
+    string cmd, address, user, pass, profileName;
+    ss >> cmd >> address >> user >> pass >> profileName;
+    
+    SocketProfile profile;
+    if (!profileName.empty() && !findSocketProfile(profileName, profile)) {
+        cout << "Unknown socket profile " << profileName << ", use default, low-latency or bulk" << endl;
+        return;
+    }
+    
+    unique_ptr<Transport> transport = Transport::fromAddress(address);
+    if (!transport) {
+        cout << "Invalid address, use host:port or unix:{socket path}" << endl;
+        return;
+    }
+    
+    ConnectionHandler* handler = new ConnectionHandler(std::move(transport));
+    handler->setProfile(profile);
+    if (!handler->connect()) {
+        cout << "Could not connect to server" << endl;
+        delete handler;
+        return;
+    }
+    session.handler = handler;
+    
+    session.listenerThread = new thread(serverListener, handler, &session.protocol, &session.capture, &session.shouldTerminate);
+    session.ackThread = new thread(ackFlusher, handler, &session.protocol, &session.shouldTerminate);
+    
+    vector<OutgoingFrame> frames = session.protocol.processUserInput(line);
+    if (!frames.empty()) {
+        if (!handler->sendFrameAscii(frames[0].frame, '\0')) {
+            cout << "Error sending login frame" << endl;
+            session.shouldTerminate = true;
+        } else if (batch && !session.protocol.waitForLogin(LOGIN_TIMEOUT_MS) && !session.shouldTerminate) {
+            cout << "No answer to login from server" << endl;
+        }
+    }
+}
+
+// Sends the frames of any other command, paced ones (replay) through the pacer. Adds the receipts the
+// frames asked for to receipts.
+void handleCommand(ClientSession& session, const string& line, bool batch, vector<shared_future<bool>>& receipts) {
+    if (!session.protocol.getIsConnected()) {
+        cout << "Please login first" << endl;
+        return;
+    }
+    
+    // A script runs its replays to the end before logging out, at the terminal logout stops them
+    if (line.substr(0, 6) == "logout" && session.pacer.pending() > 0) {
+        if (batch) {
+            session.pacer.waitIdle();
+        } else {
+            vector<OutgoingFrame> cancelled = session.pacer.cancelAll();
+            for (const OutgoingFrame& frame : cancelled) session.protocol.dropFrame(frame);
+            cout << "Replay stopped, " << cancelled.size() << " events not sent" << endl;
+        }
+    }
+    
+    ConnectionHandler* handler = session.handler;
+    vector<OutgoingFrame> frames;
+    vector<OutgoingFrame> paced;
+    for (OutgoingFrame& frame : session.protocol.processUserInput(line)) {
+        (frame.sendAfterMs < 0 ? frames : paced).push_back(std::move(frame));
+    }
+    if (!paced.empty()) {
+        int lastMs = 0;
+        for (const OutgoingFrame& frame : paced) {
+            lastMs = max(lastMs, frame.sendAfterMs);
+            if (frame.confirmed.valid()) receipts.push_back(frame.confirmed);
+        }
+        cout << "Replaying " << paced.size() << " events, the last one in " << lastMs / 1000.0 << "s" << endl;
+        session.pacer.schedule(std::move(paced));
+    }
+    // The frames of one command go out together, unless flow control makes them wait for receipts
+    bool cork = handler && frames.size() > 1 &&
+                none_of(frames.begin(), frames.end(), [](const OutgoingFrame& f) { return f.flowControlled; });
+    if (cork) handler->beginBatch();
+    for (const OutgoingFrame& frame : frames) {
+         // Report frames wait here for room in the send window
+         session.protocol.waitToSend(frame);
+         if (handler && !handler->sendFrameAscii(frame.frame, '\0')) {
+             // The listener resumes the session after a connection loss, only this frame is lost
+             if (session.protocol.getIsConnected() && !session.shouldTerminate) {
+                 cout << "Error sending frame, connection lost" << endl;
+                 continue;
+             }
+             cout << "Error sending frame" << endl;
+             session.shouldTerminate = true;
+             break;
+         }
+         if (frame.confirmed.valid()) receipts.push_back(frame.confirmed);
+    }
+    if (cork) handler->endBatch();
+}
+
+// Commands come from the terminal, or in batch mode from a file or a pipe, back to back with the
+// time each one took printed after it. --wait-receipts holds every command until the server has
+// confirmed its frames, so the time covers the round trip.
+//   StompWCIClient [--script {file}|--stdin-batch] [--wait-receipts]
 int main(int argc, char *argv[]) {
-    StompProtocol protocol;
-    bool shouldTerminate = false;
-    ConnectionHandler* handler = nullptr;
-    thread* listenerThread = nullptr;
+    string scriptPath;
+    bool batch = false;
+    bool waitReceipts = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--script" && i + 1 < argc) {
+            scriptPath = argv[++i];
+            batch = true;
+        } else if (arg == "--stdin-batch") {
+            batch = true;
+        } else if (arg == "--wait-receipts") {
+            waitReceipts = true;
+        } else {
+            cerr << "Usage: " << argv[0] << " [--script {file}|--stdin-batch] [--wait-receipts]" << endl;
+            return 1;
+        }
+    }
 
-    const short bufsize = 1024;
-    char buf[bufsize];
+    ifstream script;
+    istream* input = &cin;
+    if (!scriptPath.empty()) {
+        script.open(scriptPath);
+        if (!script) {
+            cerr << "Cannot open " << scriptPath << endl;
+            return 1;
+        }
+        input = &script;
+    }
 
-    while (!shouldTerminate) {
-        cin.getline(buf, bufsize);
-        string line(buf);
-        
-        if (line.empty()) continue;
+    ClientSession session;
+    // Receipts of commands that did not wait for them, checked once more when the input ends
+    vector<shared_future<bool>> unconfirmed;
+    string line;
+    while (!session.shouldTerminate && getline(*input, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || (batch && line[0] == '#')) continue;
 
-        if (line.substr(0, 5) == "login") {
-            if (protocol.getIsConnected()) {
-                cout << "The client is already logged in, log out before trying again" << endl;
-                continue;
-            }
-            
-            stringstream ss(line);
-            string cmd, hostPort, user, pass;
-            ss >> cmd >> hostPort >> user >> pass;
-            
-            size_t colon = hostPort.find(':');
-            if (colon == string::npos) {
-                cout << "Invalid host:port format" << endl;
-                continue;
-            }
-            string host = hostPort.substr(0, colon);
-            short port = (short)stoi(hostPort.substr(colon + 1));
-            
-            handler = new ConnectionHandler(host, port);
-            if (!handler->connect()) {
-                cout << "Could not connect to server" << endl;
-                delete handler;
-                handler = nullptr;
-                continue;
-            }
-            
-            listenerThread = new thread(serverListener, handler, &protocol, &shouldTerminate);
-            
-            vector<string> frames = protocol.processUserInput(line);
-            if (!frames.empty()) {
-                if (!handler->sendFrameAscii(frames[0], '\0')) {
-                    cout << "Error sending login frame" << endl;
-                    shouldTerminate = true;
-                }
-            }
-            
+        auto start = chrono::steady_clock::now();
+        vector<shared_future<bool>> receipts;
+        if (line.substr(0, 7) == "capture") {
+            handleCapture(session, line);
+        } else if (line.substr(0, 5) == "login") {
+            handleLogin(session, line, batch);
         } else {
-            if (!protocol.getIsConnected()) {
-                cout << "Please login first" << endl;
-                continue;
-            }
-            
-            vector<string> frames = protocol.processUserInput(line);
-            for (const string& frame : frames) {
-                 if (handler && !handler->sendFrameAscii(frame, '\0')) {
-                     cout << "Error sending frame" << endl;
-                     shouldTerminate = true;
-                     break;
-                 }
-            }
+            handleCommand(session, line, batch, receipts);
+        }
+
+        if (waitReceipts) {
+            session.pacer.waitIdle();
+            for (const shared_future<bool>& receipt : receipts) receipt.wait();
+        } else {
+            unconfirmed.insert(unconfirmed.end(), receipts.begin(), receipts.end());
+        }
+        unconfirmed.erase(remove_if(unconfirmed.begin(), unconfirmed.end(), [](const shared_future<bool>& f) {
+                              return f.wait_for(chrono::seconds(0)) == future_status::ready;
+                          }), unconfirmed.end());
+        if (batch) {
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            cout << "[" << ms << " ms] " << line << endl;
         }
     }
 
-    if (listenerThread) {
-        if (listenerThread->joinable()) listenerThread->join();
-        delete listenerThread;
+    // Out of input: replays run to the end, and frames still in flight (a last logout in particular)
+    // get their receipt or time out first
+    if (session.shouldTerminate) {
+        for (const OutgoingFrame& frame : session.pacer.cancelAll()) session.protocol.dropFrame(frame);
+    }
+    session.pacer.waitIdle();
+    for (const shared_future<bool>& receipt : unconfirmed) receipt.wait();
+    if (!session.shouldTerminate) {
+        session.shouldTerminate = true;
+        if (session.handler) session.handler->close();
+    }
+
+    session.pacer.stop();
+    if (session.listenerThread) {
+        if (session.listenerThread->joinable()) session.listenerThread->join();
+        delete session.listenerThread;
+    }
+    if (session.ackThread) {
+        if (session.ackThread->joinable()) session.ackThread->join();
+        delete session.ackThread;
     }
-    if (handler) delete handler;
+    if (session.handler) delete session.handler;
 
     return 0;
 }
\ No newline at end of file
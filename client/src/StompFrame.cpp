@@ -0,0 +1,61 @@
+#include "../include/StompFrame.h"
+
+using namespace std;
+
+const StrView *FrameView::header(const char *name) const {
+    for (size_t i = headerCount; i > 0; i--) {
+        if (headers[i - 1].name.equals(name)) return &headers[i - 1].value;
+    }
+    return nullptr;
+}
+
+string FrameView::headerOr(const char *name, const string &fallback) const {
+    const StrView *value = header(name);
+    return value ? value->str() : fallback;
+}
+
+bool parseFrame(const string &frame, FrameArena &arena, FrameView &out) {
+    return parseFrame(StrView(frame), arena, out);
+}
+
+bool parseFrame(StrView rest, FrameArena &arena, FrameView &out) {
+    out.index = StructuralIndex::build(rest, arena);
+    LineScanner lines(rest, out.index);
+    StrView line;
+    size_t colon;
+    if (!lines.next(line, colon) || line.empty() || lines.offset() > rest.size) return false;
+    out.command = line;
+
+    // First pass counts the header lines so the header array is allocated once
+    size_t count = 0;
+    LineScanner counter = lines;
+    while (counter.next(line, colon) && !line.empty()) count++;
+
+    out.headers = arena.allocateArray<HeaderView>(count);
+    out.headerCount = 0;
+    bool blankLine = false;
+    while (lines.next(line, colon)) {
+        if (line.empty()) {
+            blankLine = true;
+            break;
+        }
+        if (colon != string::npos) {
+            out.headers[out.headerCount].name = line.substr(0, colon);
+            out.headers[out.headerCount].value = line.substr(colon + 1);
+            out.headerCount++;
+        }
+    }
+
+    // The body runs up to the first '\0', or the end of the frame
+    size_t bodyStart = blankLine && lines.offset() < rest.size ? lines.offset() : rest.size;
+    out.body = rest.substr(bodyStart);
+    StructuralIndex inBody = out.index.within(out.body);
+    for (size_t i = 0; i < inBody.count; i++) {
+        size_t at = inBody.positions[i];
+        if (rest.data[at] == '\0') {
+            out.body = rest.substr(bodyStart, at - bodyStart);
+            break;
+        }
+    }
+    return true;
+}
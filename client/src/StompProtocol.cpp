@@ -2,15 +2,43 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using namespace std;
 
+// Heart-beat intervals offered in CONNECT (cx,cy of STOMP 1.2), in ms
+static const int CLIENT_HEARTBEAT_SEND_MS = 5000;
+static const int CLIENT_HEARTBEAT_RECEIVE_MS = 2000;
+
+// How long to wait for a RECEIPT before reporting the frame as unconfirmed
+static const int RECEIPT_TIMEOUT_MS = 10000;
+
+// Flow control, off until the flow command: a receipt every FLOW_BATCH frames, window between 1 and 64 batches
+static const int FLOW_BATCH = 4;
+static const int FLOW_INITIAL_BATCHES = 4;
+static const int FLOW_MAX_BATCHES = 64;
+
+// Acknowledge once this many messages are waiting, or on the next timed flush
+static const size_t ACK_BATCH_COUNT = 32;
+
 StompProtocol::StompProtocol() 
-    : currentUserName(""), subscriptionIdCounter(0), receiptIdCounter(0), isConnected(false) {}
+    : currentUserName(""), currentPasscode(""), subscriptionIdCounter(0), receiptIdCounter(0), isConnected(false),
+      channelToSubId(), subIdToChannel(), games(), pacedEvents(), pacedEventCounter(0),
+      flowControl(false), flowBatch(FLOW_BATCH), flow(FLOW_BATCH, FLOW_INITIAL_BATCHES * FLOW_BATCH, FLOW_MAX_BATCHES * FLOW_BATCH),
+      receipts(), reportReceiptEvery(0), subIdToPendingReceipt(), receiptFrames(),
+      subIdToAckMode(), unackedMessages(), unackedCount(0), dedup(), stateMutex(), loginCv(), loginAnswered(false), frameArena(),
+      compressBodies(false), codec(), deltaReports(false), keyframeInterval(10), sentState(),
+      heartbeatSendMs(0), heartbeatReceiveMs(0), heartbeatNegotiated(false), workers() {}
 
 // --- Public Methods ---
 
-vector<string> StompProtocol::processUserInput(string line) {
+vector<OutgoingFrame> StompProtocol::processUserInput(string line) {
     stringstream ss(line);
     string command;
     ss >> command;
@@ -19,82 +47,220 @@ vector<string> StompProtocol::processUserInput(string line) {
     string arg;
     while (ss >> arg) args.push_back(arg);
 
-    vector<string> framesToSend;
+    // Takes the lock only while rendering, the files are written after
+    if (command == "summary-all") {
+        handleSummaryAll(args);
+        return vector<OutgoingFrame>();
+    }
+
+    // Report files are parsed before taking the lock, so server frames keep being handled meanwhile.
+    // Not when logged out: the command is turned away below, the parse would be wasted.
+    vector<ReportFile> reportFiles;
+    bool loggedIn;
+    {
+        lock_guard<mutex> lock(stateMutex);
+        loggedIn = isConnected;
+    }
+    if (loggedIn && command == "report") reportFiles = loadReportFiles(args);
+    if (loggedIn && command == "replay" && !args.empty()) reportFiles = loadReportFiles(vector<string>(1, args[0]));
+
+    lock_guard<mutex> lock(stateMutex);
+
+    vector<OutgoingFrame> framesToSend;
 
     if (command == "login") {
-        framesToSend.push_back(handleLogin(args));
+        framesToSend.push_back(OutgoingFrame(handleLogin(args)));
     } else if (!isConnected) {
         cout << "Please login first" << endl;
     } else if (command == "join") {
         framesToSend.push_back(handleJoin(args));
     } else if (command == "exit") {
         framesToSend.push_back(handleExit(args));
+    } else if (command == "flow") {
+        handleFlow(args);
     } else if (command == "report") {
-        return handleReport(args); 
+        return handleReport(reportFiles); 
+    } else if (command == "replay") {
+        return handleReplay(args, reportFiles);
     } else if (command == "summary") {
         handleSummary(args); 
+    } else if (command == "compress") {
+        handleCompress(args);
+    } else if (command == "receipts") {
+        handleReceipts(args);
+    } else if (command == "delta") {
+        handleDelta(args);
+    } else if (command == "memory") {
+        handleMemory(args);
     } else if (command == "logout") {
         framesToSend.push_back(handleLogout(args));
     } else {
         cout << "Unknown command" << endl;
     }
 
+    // Handlers return an empty frame when the command was rejected
+    framesToSend.erase(remove_if(framesToSend.begin(), framesToSend.end(),
+                                 [](const OutgoingFrame& f) { return f.frame.empty(); }),
+                       framesToSend.end());
     return framesToSend;
 }
 
-bool StompProtocol::processServerFrame(string frame) {
-    stringstream ss(frame);
-    string command;
-    getline(ss, command); 
-
-    map<string, string> headers;
-    string line;
-    while (getline(ss, line) && line != "") {
-        if (!line.empty() && line.back() == '\r') line.pop_back();
-        size_t colonPos = line.find(':');
-        if (colonPos != string::npos) {
-            headers[line.substr(0, colonPos)] = line.substr(colonPos + 1);
-        }
+void StompProtocol::waitToSend(const OutgoingFrame& frame) {
+    if (frame.flowControlled) {
+        flow.acquire();
+        flow.sent();
     }
+    if (frame.receiptId >= 0) receipts.restart(frame.receiptId);
+}
 
-    string body = "";
-    char c;
-    while (ss.get(c)) { 
-        if (c != '\0') body += c; 
-    }
+bool StompProtocol::processServerFrame(string frame) {
+    lock_guard<mutex> lock(stateMutex);
+    frameArena.reset();
+    FrameView view;
+    if (!parseFrame(frame, frameArena, view)) return false;
+    StrView command = view.command;
 
-    if (command == "CONNECTED") {
+    if (command.equals("CONNECTED")) {
         isConnected = true;
+        negotiateHeartbeat(view.headerOr("heart-beat", "0,0"));
         cout << "Login successful" << endl;
+        loginAnswered = true;
+        loginCv.notify_all();
     } 
-    else if (command == "ERROR") {
+    else if (command.equals("ERROR")) {
         cout << "Error received from server: " << endl;
-        if (headers.count("message")) cout << headers["message"] << endl;
-        cout << body << endl;
+        if (const StrView* message = view.header("message")) cout << message->str() << endl;
+        cout << view.body.str() << endl;
         isConnected = false;
+        loginAnswered = true;
+        loginCv.notify_all();
         return true; 
     } 
-    else if (command == "RECEIPT") {
-        if (headers.count("receipt-id")) {
-            int rId = stoi(headers["receipt-id"]);
-            if (pendingReceipts.count(rId)) {
-                string action = pendingReceipts[rId];
+    else if (command.equals("RECEIPT")) {
+        if (const StrView* receiptId = view.header("receipt-id")) {
+            int rId = stoi(receiptId->str());
+            string action;
+            if (receipts.complete(rId, action)) {
                 if (action == "logout") {
                     return true; 
                 } else {
-                    cout << action << endl; 
-                    pendingReceipts.erase(rId);
+                    if (!action.empty()) cout << action << endl; 
+                    receiptFrames.erase(rId);
+                    for (auto it = subIdToPendingReceipt.begin(); it != subIdToPendingReceipt.end(); ++it) {
+                        if (it->second == rId) {
+                            subIdToPendingReceipt.erase(it);
+                            break;
+                        }
+                    }
                 }
             }
         }
     } 
-    else if (command == "MESSAGE") {
-        handleServerMessage(body, headers);
+    else if (command.equals("MESSAGE")) {
+        handleServerMessage(view);
+        recordAck(view);
     }
 
     return false; 
 }
 
+vector<string> StompProtocol::buildResumeFrames() {
+    lock_guard<mutex> lock(stateMutex);
+    vector<string> frames;
+
+    map<string, string> connect;
+    connect["accept-version"] = "1.2";
+    connect["host"] = "stomp.cs.bgu.ac.il";
+    connect["login"] = currentUserName;
+    connect["passcode"] = currentPasscode;
+    connect["heart-beat"] = to_string(CLIENT_HEARTBEAT_SEND_MS) + "," + to_string(CLIENT_HEARTBEAT_RECEIVE_MS);
+    frames.push_back(buildFrame("CONNECT", connect, ""));
+
+    for (auto const& sub : subIdToChannel) {
+        map<string, string> headers;
+        headers["destination"] = "/" + sub.second;
+        headers["id"] = to_string(sub.first);
+        auto pending = subIdToPendingReceipt.find(sub.first);
+        if (pending != subIdToPendingReceipt.end()) headers["receipt"] = to_string(pending->second);
+        if (subIdToAckMode.count(sub.first)) headers["ack"] = subIdToAckMode[sub.first];
+        frames.push_back(buildFrame("SUBSCRIBE", headers, ""));
+    }
+
+    for (auto const& pending : receiptFrames) frames.push_back(pending.second);
+    // The resent frames get a fresh timeout on the new connection, ack IDs of the old one are void
+    receipts.rearm();
+    unackedMessages.clear();
+    unackedCount = 0;
+    // A restarted broker numbers its messages from scratch, only content hashes carry over
+    for (auto& window : dedup) window.second.resetIds();
+    return frames;
+}
+
+vector<OutgoingFrame> StompProtocol::takeAckFrames(bool force) {
+    lock_guard<mutex> lock(stateMutex);
+    vector<OutgoingFrame> frames;
+    if (unackedCount == 0 || (!force && unackedCount < ACK_BATCH_COUNT)) return frames;
+
+    string batch;
+    for (auto const& sub : unackedMessages) {
+        const vector<string>& ids = sub.second;
+        if (ids.empty()) continue;
+        if (subIdToAckMode[sub.first] == "client") {
+            // Cumulative: acknowledging the newest message covers everything before it
+            map<string, string> headers;
+            headers["id"] = ids.back();
+            batch += buildFrame("ACK", headers, "");
+        } else {
+            for (const string& id : ids) {
+                map<string, string> headers;
+                headers["id"] = id;
+                batch += buildFrame("ACK", headers, "");
+            }
+        }
+    }
+    unackedMessages.clear();
+    unackedCount = 0;
+
+    // buildFrame already terminates every frame, drop the last terminator since the sender adds one
+    if (!batch.empty()) {
+        batch.pop_back();
+        frames.push_back(OutgoingFrame(batch));
+    }
+    return frames;
+}
+
+void StompProtocol::frameSent(const OutgoingFrame& frame) {
+    if (frame.pacedEventId < 0) return;
+    lock_guard<mutex> lock(stateMutex);
+    auto paced = pacedEvents.find(frame.pacedEventId);
+    if (paced == pacedEvents.end()) return;
+    updateGameStats(paced->second.gameName, paced->second.event, paced->second.reporter);
+    pacedEvents.erase(paced);
+}
+
+void StompProtocol::dropFrame(const OutgoingFrame& frame) {
+    if (frame.receiptId >= 0) receipts.cancel(frame.receiptId);
+    if (frame.pacedEventId >= 0) {
+        lock_guard<mutex> lock(stateMutex);
+        pacedEvents.erase(frame.pacedEventId);
+    }
+}
+
+bool StompProtocol::waitForLogin(int timeoutMs) {
+    unique_lock<mutex> lock(stateMutex);
+    loginCv.wait_for(lock, chrono::milliseconds(timeoutMs), [this]() { return loginAnswered; });
+    return isConnected;
+}
+
+bool StompProtocol::takeHeartbeat(int& sendEveryMs, int& receiveTimeoutMs) {
+    lock_guard<mutex> lock(stateMutex);
+    if (!heartbeatNegotiated) return false;
+    heartbeatNegotiated = false;
+    sendEveryMs = heartbeatSendMs;
+    receiveTimeoutMs = heartbeatReceiveMs;
+    return true;
+}
+
 // --- Private Handlers ---
 
 string StompProtocol::handleLogin(const vector<string>& args) {
@@ -103,11 +269,13 @@ string StompProtocol::handleLogin(const vector<string>& args) {
         return "";
     }
     if (args.size() < 3) {
-        cout << "Usage: login {host:port} {username} {password}" << endl;
+        cout << "Usage: login {host:port[,host:port...]|unix:{path}} {username} {password} [default|low-latency|bulk]" << endl;
         return "";
     }
     
     currentUserName = args[1];
+    currentPasscode = args[2];
+    loginAnswered = false;
     string password = args[2];
 
     map<string, string> headers;
@@ -115,21 +283,28 @@ string StompProtocol::handleLogin(const vector<string>& args) {
     headers["host"] = "stomp.cs.bgu.ac.il";
     headers["login"] = currentUserName;
     headers["passcode"] = password;
+    headers["heart-beat"] = to_string(CLIENT_HEARTBEAT_SEND_MS) + "," + to_string(CLIENT_HEARTBEAT_RECEIVE_MS);
 
     return buildFrame("CONNECT", headers, "");
 }
 
-string StompProtocol::handleJoin(const vector<string>& args) {
-    if (args.empty()) return "";
+OutgoingFrame StompProtocol::handleJoin(const vector<string>& args) {
+    if (args.empty()) return OutgoingFrame("");
     string gameName = args[0];
+    string ackMode = args.size() > 1 ? args[1] : "auto";
+    if (ackMode != "auto" && ackMode != "client" && ackMode != "client-individual") {
+        cout << "Usage: join {game_name} [auto|client|client-individual]" << endl;
+        return OutgoingFrame("");
+    }
 
     int id = subscriptionIdCounter++;
-    int receipt = receiptIdCounter++;
+    shared_future<bool> confirmed;
+    int receipt = expectReceipt("Joined channel " + gameName, ReceiptManager::Callback(), &confirmed);
 
     channelToSubId[gameName] = id;
     subIdToChannel[id] = gameName;
     
-    pendingReceipts[receipt] = "Joined channel " + gameName;
+    subIdToPendingReceipt[id] = receipt;
 
     if (games.find(gameName) == games.end()) {
         games[gameName] = GameState("Team A", "Team B"); 
@@ -139,132 +314,326 @@ string StompProtocol::handleJoin(const vector<string>& args) {
     headers["destination"] = "/" + gameName;
     headers["id"] = to_string(id);
     headers["receipt"] = to_string(receipt);
+    if (ackMode != "auto") {
+        headers["ack"] = ackMode;
+        subIdToAckMode[id] = ackMode;
+    }
 
-    return buildFrame("SUBSCRIBE", headers, "");
+    return OutgoingFrame(buildFrame("SUBSCRIBE", headers, ""), receipt, false, confirmed);
 }
 
-string StompProtocol::handleExit(const vector<string>& args) {
-    if (args.empty()) return "";
+OutgoingFrame StompProtocol::handleExit(const vector<string>& args) {
+    if (args.empty()) return OutgoingFrame("");
     string gameName = args[0];
 
     if (channelToSubId.find(gameName) == channelToSubId.end()) {
         cout << "Not subscribed to " << gameName << endl;
-        return "";
+        return OutgoingFrame("");
     }
 
     int id = channelToSubId[gameName];
-    int receipt = receiptIdCounter++;
+    shared_future<bool> confirmed;
+    int receipt = expectReceipt("Exited channel " + gameName, ReceiptManager::Callback(), &confirmed);
 
     channelToSubId.erase(gameName);
     subIdToChannel.erase(id);
-    
-    pendingReceipts[receipt] = "Exited channel " + gameName;
+    subIdToPendingReceipt.erase(id);
+    subIdToAckMode.erase(id);
+    dedup.erase(id);
+    if (unackedMessages.count(id)) {
+        unackedCount -= unackedMessages[id].size();
+        unackedMessages.erase(id);
+    }
 
     map<string, string> headers;
     headers["id"] = to_string(id);
     headers["receipt"] = to_string(receipt);
 
-    return buildFrame("UNSUBSCRIBE", headers, "");
+    receiptFrames[receipt] = buildFrame("UNSUBSCRIBE", headers, "");
+    return OutgoingFrame(receiptFrames[receipt], receipt, false, confirmed);
 }
 
-string StompProtocol::handleLogout(const vector<string>& args) {
-    int receipt = receiptIdCounter++;
-    pendingReceipts[receipt] = "logout";
+OutgoingFrame StompProtocol::handleLogout(const vector<string>& args) {
+    shared_future<bool> confirmed;
+    int receipt = expectReceipt("logout", ReceiptManager::Callback(), &confirmed);
 
     map<string, string> headers;
     headers["receipt"] = to_string(receipt);
 
-    return buildFrame("DISCONNECT", headers, "");
+    receiptFrames[receipt] = buildFrame("DISCONNECT", headers, "");
+    return OutgoingFrame(receiptFrames[receipt], receipt, false, confirmed);
 }
 
-vector<string> StompProtocol::handleReport(const vector<string>& args) {
-    vector<string> frames;
-    if (args.empty()) return frames;
-    
-    string file = args[0];
-    names_and_events data;
+// Events files named on the command line, directories expanded to the .json files they hold
+static vector<string> expandReportPaths(const vector<string>& args) {
+    vector<string> paths;
+    for (const string& arg : args) {
+        struct stat info;
+        DIR* dir = (stat(arg.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) ? opendir(arg.c_str()) : nullptr;
+        if (!dir) {
+            paths.push_back(arg);
+            continue;
+        }
+        vector<string> inDir;
+        while (struct dirent* entry = readdir(dir)) {
+            string name = entry->d_name;
+            if (name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0) {
+                inDir.push_back(arg + (arg.back() == '/' ? "" : "/") + name);
+            }
+        }
+        closedir(dir);
+        sort(inDir.begin(), inDir.end());
+        paths.insert(paths.end(), inDir.begin(), inDir.end());
+    }
+    return paths;
+}
+
+vector<ReportFile> StompProtocol::loadReportFiles(const vector<string>& args) {
+    vector<ReportFile> files;
+    for (const string& path : expandReportPaths(args)) {
+        files.push_back(ReportFile());
+        files.back().path = path;
+    }
+    workers.run(files.size(), [&files](size_t i) {
+        try {
+            files[i].data = parseEventsFile(files[i].path);
+            files[i].parsed = true;
+        } catch (...) {
+        }
+    });
+    return files;
+}
+
+vector<OutgoingFrame> StompProtocol::handleReplay(const vector<string>& args, const vector<ReportFile>& files) {
+    double speed = 0;
     try {
-        data = parseEventsFile(file); 
+        if (args.size() == 2) speed = stod(args[1]);
     } catch (...) {
-        cout << "Error parsing file" << endl;
+    }
+    if (speed <= 0) {
+        cout << "Usage: replay {file|directory} {speed}, speed 1 for real time, 60 for a minute of game time per second" << endl;
+        return vector<OutgoingFrame>();
+    }
+    return handleReport(files, speed);
+}
+
+vector<OutgoingFrame> StompProtocol::handleReport(const vector<ReportFile>& files, double speed) {
+    vector<OutgoingFrame> frames;
+    if (files.empty()) {
+        cout << "Usage: report {file|directory} [more files...]" << endl;
         return frames;
     }
 
-    string gameName = data.team_a_name + "_" + data.team_b_name;
-    
-    if (games.find(gameName) == games.end()) {
-        games[gameName] = GameState(data.team_a_name, data.team_b_name);
-    } else {
-        games[gameName].team_a = data.team_a_name;
-        games[gameName].team_b = data.team_b_name;
+    // Each game's events, one stream per file, the file name riding on the file's first event
+    typedef vector<pair<const Event*, const string*>> EventStream;
+    vector<string> gameOrder;
+    map<string, vector<EventStream>> streams;
+    for (const ReportFile& file : files) {
+        if (!file.parsed) {
+            cout << "Error parsing file " << file.path << endl;
+            continue;
+        }
+        const names_and_events& data = file.data;
+        string gameName = data.team_a_name + "_" + data.team_b_name;
+        if (games.find(gameName) == games.end()) {
+            games[gameName] = GameState(data.team_a_name, data.team_b_name);
+        } else {
+            games[gameName].team_a = data.team_a_name;
+            games[gameName].team_b = data.team_b_name;
+        }
+        if (!streams.count(gameName)) gameOrder.push_back(gameName);
+
+        EventStream stream;
+        for (const Event& event : data.events) {
+            stream.push_back(make_pair(&event, stream.empty() ? &file.path : nullptr));
+        }
+        streams[gameName].push_back(stream);
+    }
+
+    // Files of the same game are merged by time; ties and each file's own order are kept
+    auto byTime = [](const pair<const Event*, const string*>& a, const pair<const Event*, const string*>& b) {
+        return a.first->get_time() < b.first->get_time();
+    };
+    for (const string& gameName : gameOrder) {
+        EventStream merged;
+        for (const EventStream& stream : streams[gameName]) {
+            EventStream next;
+            merge(merged.begin(), merged.end(), stream.begin(), stream.end(), back_inserter(next), byTime);
+            merged.swap(next);
+        }
+        appendGameReport(gameName, merged, frames, speed);
     }
+    return frames;
+}
 
-    bool isFirstEvent = true;
-    for (const auto& event : data.events) {
-        updateGameStats(gameName, event, currentUserName);
+void StompProtocol::appendGameReport(const string& gameName, const vector<pair<const Event*, const string*>>& events,
+                                     vector<OutgoingFrame>& frames, double speed) {
+    size_t sent = 0;
+    // Paced frames are not windowed, the pace already limits them; they still confirm the last event
+    bool paced = speed > 0;
+    bool windowed = flowControl && !paced;
+    int receiptEvery = windowed ? flowBatch : reportReceiptEvery;
+    if (paced && receiptEvery == 0) receiptEvery = static_cast<int>(events.size());
+    int firstTime = events.empty() ? 0 : events.front().first->get_time();
+    int sinceReceipt = 0;
+    auto subscription = channelToSubId.find(gameName);
+    for (const auto& item : events) {
+        const Event& event = *item.first;
+        // A replayed event is applied when the pacer writes it, see frameSent
+        if (!paced) updateGameStats(gameName, event, currentUserName);
+        // Our own events come back from the server, they are already applied
+        if (subscription != channelToSubId.end()) {
+            dedup[subscription->second].seenHash(DedupWindow::hashEvent(StrView(currentUserName), StrView(gameName), event.get_time(), StrView(event.get_name())));
+        }
 
         map<string, string> headers;
         headers["destination"] = "/" + gameName;
 
-        if (isFirstEvent) {
-            headers["file"] = file;
-            isFirstEvent = false;
-        }
-        
-        string body = "user: " + currentUserName + "\n";
-        body += "team a: " + data.team_a_name + "\n";
-        body += "team b: " + data.team_b_name + "\n";
-        body += "event name: " + event.get_name() + "\n";
-        body += "time: " + to_string(event.get_time()) + "\n";
-        
-        body += "general game updates:\n";
-        for (auto const& [key, val] : event.get_game_updates()) body += key + ": " + val + "\n";
-        
-        body += "team a updates:\n";
-        for (auto const& [key, val] : event.get_team_a_updates()) body += key + ": " + val + "\n";
-        
-        body += "team b updates:\n";
-        for (auto const& [key, val] : event.get_team_b_updates()) body += key + ": " + val + "\n";
+        if (item.second) headers["file"] = *item.second;
         
-        body += "description:\n" + event.get_discription();
+        string body = buildEventBody(gameName, event);
+
+        // One receipt per batch of frames instead of none or one per frame
+        sent++;
+        sinceReceipt++;
+        int receipt = -1;
+        shared_future<bool> confirmed;
+        bool last = (sent == events.size());
+        if (receiptEvery > 0 && (sinceReceipt == receiptEvery || last)) {
+            // Under flow control only the last receipt is worth printing
+            string action = (!windowed || last) ? "Server confirmed " + to_string(sent) + " of " +
+                                                  to_string(events.size()) + " events for " + gameName : "";
+            ReceiptManager::Callback onDone;
+            if (windowed) {
+                FlowController* window = &flow;
+                int covers = sinceReceipt;
+                onDone = [window, covers](bool confirmed, long rttMicros) {
+                    if (confirmed) window->onAck(covers, rttMicros);
+                    else window->onLoss(covers);
+                };
+            }
+            // A paced frame's receipt clock starts when it is written (waitToSend)
+            receipt = expectReceipt(action, onDone, &confirmed, !paced);
+            headers["receipt"] = to_string(receipt);
+            sinceReceipt = 0;
+        }
+
+        if (compressBodies) {
+            headers["content-encoding"] = BodyCodec::ENCODING_NAME;
+            body = codec.encode(body);
+        }
 
-        frames.push_back(buildFrame("SEND", headers, body));
+        frames.push_back(OutgoingFrame(buildFrame("SEND", headers, body), receipt, windowed && receiptEvery > 0, confirmed));
+        if (paced) {
+            frames.back().sendAfterMs = static_cast<int>((event.get_time() - firstTime) * 1000.0 / speed);
+            frames.back().pacedEventId = pacedEventCounter;
+            pacedEvents.insert(make_pair(pacedEventCounter++, PacedEvent(gameName, currentUserName, event)));
+        }
     }
-    return frames;
 }
 
-void StompProtocol::handleServerMessage(const string& body, const map<string, string>& headers) {
-    string gameName = "";
-    if (headers.count("destination")) {
-        gameName = headers.at("destination");
-        if (gameName.size()>0 && gameName[0] == '/') gameName = gameName.substr(1);
-    }
-
-    // Extract user from body manually
-    string user = "unknown";
-    stringstream ss(body);
-    string line;
-    if (getline(ss, line)) {
-        size_t colon = line.find("user:");
-        if (colon != string::npos) {
-            user = line.substr(colon + 5);
-            // Trim whitespace
-            size_t first = user.find_first_not_of(' ');
-            if (first != string::npos) user = user.substr(first);
-            if (!user.empty() && user.back() == '\r') user.pop_back();
+// Appends a stats section; an empty section is left out entirely unless forced
+static void appendSection(string& body, const string& title, const map<string, string>& stats, bool force) {
+    if (stats.empty() && !force) return;
+    body += title + "\n";
+    for (auto const& kv : stats) body += kv.first + ": " + kv.second + "\n";
+}
+
+// Merges an event's updates into the last reported stats, collecting the ones that actually changed
+static void collectChanges(map<string, string>& last, const map<string, string>& updates, map<string, string>& changed) {
+    for (auto const& kv : updates) {
+        auto it = last.find(kv.first);
+        if (it == last.end() || it->second != kv.second) {
+            changed[kv.first] = kv.second;
+            last[kv.first] = kv.second;
         }
     }
+}
+
+string StompProtocol::buildEventBody(const string& gameName, const Event& event) {
+    string body = "user: " + currentUserName + "\n";
+    bool full = true;
+    map<string, string> general = event.get_game_updates();
+    map<string, string> teamA = event.get_team_a_updates();
+    map<string, string> teamB = event.get_team_b_updates();
+
+    if (deltaReports) {
+        DeltaState& last = sentState[gameName];
+        map<string, string> changedGeneral, changedA, changedB;
+        collectChanges(last.general_stats, general, changedGeneral);
+        collectChanges(last.team_a_stats, teamA, changedA);
+        collectChanges(last.team_b_stats, teamB, changedB);
+
+        // Keyframes carry the whole reported state so late joiners can catch up
+        full = (last.eventsSinceKeyframe == 0);
+        last.eventsSinceKeyframe = (last.eventsSinceKeyframe + 1) % keyframeInterval;
+        if (full) {
+            general = last.general_stats;
+            teamA = last.team_a_stats;
+            teamB = last.team_b_stats;
+        } else {
+            general.swap(changedGeneral);
+            teamA.swap(changedA);
+            teamB.swap(changedB);
+        }
+    }
+
+    if (full) {
+        body += "team a: " + event.get_team_a_name() + "\n";
+        body += "team b: " + event.get_team_b_name() + "\n";
+    }
+    body += "event name: " + event.get_name() + "\n";
+    body += "time: " + to_string(event.get_time()) + "\n";
+    appendSection(body, "general game updates:", general, full);
+    appendSection(body, "team a updates:", teamA, full);
+    appendSection(body, "team b updates:", teamB, full);
+    body += "description:\n" + event.get_discription();
+    return body;
+}
+
+void StompProtocol::handleServerMessage(const FrameView& frame) {
+    StrView body = frame.body;
+    bool indexed = true;
+    string decoded;
+    if (const StrView* encoding = frame.header("content-encoding")) {
+        if (!encoding->equals(BodyCodec::ENCODING_NAME.c_str()) || !codec.decode(frame.body.str(), decoded)) {
+            cout << "Dropping message with unsupported content-encoding " << encoding->str() << endl;
+            return;
+        }
+        body = StrView(decoded);
+        indexed = false;
+    }
+
+    string gameName = "";
+    if (const StrView* destination = frame.header("destination")) {
+        gameName = (destination->size > 0 && destination->data[0] == '/') ? destination->substr(1).str() : destination->str();
+    }
+
+    // Parsed in place, nothing is copied out until the event is known to be new
+    EventView event = indexed ? EventView::parse(body, frame.index, frameArena) : EventView::parse(body, frameArena);
+    StrView user = event.user.empty() ? StrView("unknown", 7) : event.user;
 
-    // Use Event constructor that parses the body
-    Event event(body);
-    
     if (gameName.empty()) {
-        gameName = event.get_team_a_name() + "_" + event.get_team_b_name();
+        gameName = event.team_a_name.str() + "_" + event.team_b_name.str();
     }
 
-    updateGameStats(gameName, event, user);
-    cout << "Game update received for " << gameName << " from " << user << ":" << endl;
-    cout << event.get_discription() << endl; 
+    // Duplicates (same message-id, or same user/game/time/name) are dropped, after a reconnect or a re-publish
+    int subId = -1;
+    long messageId = -1;
+    try {
+        if (const StrView* subscription = frame.header("subscription")) subId = stoi(subscription->str());
+        if (const StrView* id = frame.header("message-id")) messageId = stol(id->str());
+    } catch (...) {
+    }
+    DedupWindow& window = dedup[subId];
+    bool duplicateId = window.seenId(messageId);
+    bool duplicateContent = window.seenHash(DedupWindow::hashEvent(user, StrView(gameName), event.time, event.name));
+    if (duplicateId || duplicateContent) return;
+
+    Event retained = event.toEvent();
+    updateGameStats(gameName, retained, user.str());
+    cout << "Game update received for " << gameName << " from " << user.str() << ":" << endl;
+    cout << retained.get_discription() << endl; 
     cout << "----------------------------------------" << endl;
 }
 
@@ -274,9 +643,11 @@ void StompProtocol::updateGameStats(string gameName, const Event& event, string
     }
     
     GameState& game = games[gameName];
+    if (!event.get_team_a_name().empty()) game.team_a = event.get_team_a_name();
+    if (!event.get_team_b_name().empty()) game.team_b = event.get_team_b_name();
     
-    // Save report under specific user
-    game.reports[reporter].push_back(event);
+    // Save report under specific user, the team names are kept once per game
+    game.reports[reporter].push_back(game.store.add(event));
     
     // Update general stats
     for (auto const& [k, v] : event.get_game_updates()) game.general_stats[k] = v;
@@ -284,6 +655,53 @@ void StompProtocol::updateGameStats(string gameName, const Event& event, string
     for (auto const& [k, v] : event.get_team_b_updates()) game.team_b_stats[k] = v;
 }
 
+// The summary file of one user's reports on a game
+static string renderSummary(const GameState& game, const string& user) {
+    string out = game.team_a + " vs " + game.team_b + "\n";
+    out += "Game stats:\n";
+    out += "General stats:\n";
+    for (auto const& kv : game.general_stats) out += kv.first + ": " + kv.second + "\n";
+    
+    out += game.team_a + " stats:\n";
+    for (auto const& kv : game.team_a_stats) out += kv.first + ": " + kv.second + "\n";
+    
+    out += game.team_b + " stats:\n";
+    for (auto const& kv : game.team_b_stats) out += kv.first + ": " + kv.second + "\n";
+    
+    out += "Game event reports:\n";
+    
+    auto reports = game.reports.find(user);
+    if (reports != game.reports.end()) {
+        for (uint32_t index : reports->second) {
+            const StoredEvent& e = game.store.get(index);
+            out += to_string(e.time) + " - " + game.store.name(e) + ":\n";
+            StrView description = game.store.description(e);
+            out.append(description.data, description.size);
+            out += "\n\n";
+        }
+    }
+    return out;
+}
+
+// Writes text to path with a single write in the common case. Returns false, with errno set, on failure.
+static bool writeWholeFile(const string& path, const string& text) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t n = write(fd, text.data() + written, text.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return false;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return close(fd) == 0;
+}
+
 void StompProtocol::handleSummary(const vector<string>& args) {
     if (args.size() < 3) {
         cout << "Usage: summary {game_name} {user} {file}" << endl;
@@ -304,34 +722,210 @@ void StompProtocol::handleSummary(const vector<string>& args) {
         cout << "No reports found from user " << user << " for this game." << endl;
     }
 
-    ofstream out(file);
-    if (!out) {
+    if (!writeWholeFile(file, renderSummary(game, user))) {
         cout << "Error opening file " << file << endl;
         return;
     }
+    cout << "Summary created in " << file << endl;
+}
 
-    out << game.team_a << " vs " << game.team_b << endl;
-    out << "Game stats:" << endl;
-    out << "General stats:" << endl;
-    for (auto const& [k, v] : game.general_stats) out << k << ": " << v << endl;
-    
-    out << game.team_a << " stats:" << endl;
-    for (auto const& [k, v] : game.team_a_stats) out << k << ": " << v << endl;
-    
-    out << game.team_b << " stats:" << endl;
-    for (auto const& [k, v] : game.team_b_stats) out << k << ": " << v << endl;
-    
-    out << "Game event reports:" << endl;
-    
-    if (game.reports.count(user)) {
-        for (const Event& e : game.reports[user]) {
-            out << e.get_time() << " - " << e.get_name() << ":" << endl;
-            out << e.get_discription() << endl << endl;
+void StompProtocol::handleSummaryAll(const vector<string>& args) {
+    if (args.size() != 1) {
+        cout << "Usage: summary-all {directory}" << endl;
+        return;
+    }
+    string dir = args[0];
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        cout << "Error creating directory " << dir << ": " << strerror(errno) << endl;
+        return;
+    }
+
+    // Every (game, user) pair is rendered under the lock, the rendered text being the snapshot: event
+    // descriptions are only valid until the next event is stored. Writing the files needs no lock.
+    vector<pair<string, string>> files;
+    auto start = chrono::steady_clock::now();
+    {
+        lock_guard<mutex> lock(stateMutex);
+        if (!isConnected) {
+            cout << "Please login first" << endl;
+            return;
+        }
+        vector<pair<const GameState*, const string*>> pairs;
+        for (auto const& game : games) {
+            for (auto const& reporter : game.second.reports) {
+                pairs.push_back(make_pair(&game.second, &reporter.first));
+                files.push_back(make_pair(dir + "/" + game.first + "-" + reporter.first + ".txt", string()));
+            }
         }
+        workers.run(pairs.size(), [&pairs, &files](size_t i) { files[i].second = renderSummary(*pairs[i].first, *pairs[i].second); });
     }
-    
-    out.close();
-    cout << "Summary created in " << file << endl;
+    auto rendered = chrono::steady_clock::now();
+
+    vector<char> failed(files.size(), 0);
+    workers.run(files.size(), [&files, &failed](size_t i) { failed[i] = !writeWholeFile(files[i].first, files[i].second); });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t errors = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (failed[i] && errors++ < 5) cout << "Error writing " << files[i].first << endl;
+    }
+    cout << "Wrote " << files.size() - errors << " summaries to " << dir << " in " << seconds * 1000 << " ms ("
+         << static_cast<long>(seconds > 0 ? (files.size() - errors) / seconds : 0) << " files/s, "
+         << chrono::duration<double, milli>(rendered - start).count() << " ms rendering, pool of " << workers.size()
+         << ")" << endl;
+}
+
+void StompProtocol::handleMemory(const vector<string>& args) {
+    if (!args.empty() && !games.count(args[0])) {
+        cout << "Game not found." << endl;
+        return;
+    }
+    size_t total = 0;
+    for (auto const& entry : games) {
+        if (!args.empty() && entry.first != args[0]) continue;
+        const EventStore& store = entry.second.store;
+        StringStoreStats d = store.descriptionStats();
+        cout << entry.first << ": " << store.size() << " events from " << entry.second.reports.size() << " users, "
+             << d.strings << " distinct descriptions for " << d.references << " events, "
+             << d.bytesStored << " of " << d.bytesReferenced << " description bytes kept, "
+             << store.bytesUsed() << " bytes in total" << endl;
+        total += store.bytesUsed();
+    }
+    cout << "Retained events use " << total << " bytes" << endl;
+}
+
+void StompProtocol::handleCompress(const vector<string>& args) {
+    if (args.empty() || (args[0] != "on" && args[0] != "off" && args[0] != "stats")) {
+        cout << "Usage: compress {on|off|stats}" << endl;
+        return;
+    }
+    if (args[0] == "on" || args[0] == "off") {
+        compressBodies = (args[0] == "on");
+        cout << "Report body compression " << (compressBodies ? "enabled" : "disabled") << endl;
+        return;
+    }
+
+    const CodecStats& s = codec.getStats();
+    cout << "Encoded " << s.framesEncoded << " bodies: " << s.bytesBefore << " -> " << s.bytesAfter << " bytes";
+    if (s.bytesBefore > 0) {
+        cout << " (" << (100 * (s.bytesBefore - s.bytesAfter) / s.bytesBefore) << "% saved)";
+    }
+    cout << endl;
+    if (s.framesEncoded > 0) {
+        cout << "Encode cost: " << s.encodeNanos / 1000 << " us total, "
+             << s.encodeNanos / s.framesEncoded << " ns/body, "
+             << (s.bytesBefore > 0 ? s.encodeNanos * 1000 / s.bytesBefore : 0) << " ps/byte" << endl;
+    }
+    cout << "Decoded " << s.framesDecoded << " bodies";
+    if (s.framesDecoded > 0) cout << ", " << s.decodeNanos / s.framesDecoded << " ns/body";
+    cout << endl;
+}
+
+void StompProtocol::handleDelta(const vector<string>& args) {
+    if (args.empty() || (args[0] != "on" && args[0] != "off")) {
+        cout << "Usage: delta {on|off} [keyframe interval]" << endl;
+        return;
+    }
+    deltaReports = (args[0] == "on");
+    if (args.size() > 1) {
+        try {
+            keyframeInterval = max(1, stoi(args[1]));
+        } catch (...) {
+            cout << "Invalid keyframe interval " << args[1] << endl;
+        }
+    }
+    // Start every game with a keyframe after switching modes
+    sentState.clear();
+    cout << "Delta reports " << (deltaReports ? "enabled, keyframe every " + to_string(keyframeInterval) + " events" : "disabled") << endl;
+}
+
+void StompProtocol::handleReceipts(const vector<string>& args) {
+    if (args.size() >= 2 && args[0] == "every") {
+        try {
+            reportReceiptEvery = max(0, stoi(args[1]));
+            cout << "Report receipts " << (reportReceiptEvery > 0 ? "every " + to_string(reportReceiptEvery) + " frames" : "disabled") << endl;
+        } catch (...) {
+            cout << "Usage: receipts [every {N}]" << endl;
+        }
+        return;
+    }
+
+    map<int, pair<string, long>> waiting = receipts.snapshot();
+    cout << waiting.size() << " receipts pending" << endl;
+    for (auto const& entry : waiting) {
+        cout << "  " << entry.first << ": " << entry.second.first << " (" << entry.second.second << "ms)" << endl;
+    }
+}
+
+void StompProtocol::recordAck(const FrameView& frame) {
+    const StrView* subscription = frame.header("subscription");
+    if (!subscription) return;
+    int subId;
+    try {
+        subId = stoi(subscription->str());
+    } catch (...) {
+        return;
+    }
+    if (!subIdToAckMode.count(subId)) return;
+
+    // STOMP 1.2 servers name the message to acknowledge in the ack header
+    const StrView* ackId = frame.header("ack");
+    if (!ackId) ackId = frame.header("message-id");
+    if (!ackId) return;
+    unackedMessages[subId].push_back(ackId->str());
+    unackedCount++;
+}
+
+int StompProtocol::expectReceipt(const string& action, ReceiptManager::Callback onDone, shared_future<bool>* receiptFuture,
+                                 bool armNow) {
+    int receipt = receiptIdCounter++;
+    shared_future<bool> future = receipts.expect(receipt, action, RECEIPT_TIMEOUT_MS, [receipt, action, onDone](bool confirmed, long rttMicros) {
+        if (!confirmed) cout << "No receipt " << receipt << " from server" << (action.empty() ? "" : " for: " + action) << endl;
+        if (onDone) onDone(confirmed, rttMicros);
+    }, armNow);
+    if (receiptFuture) *receiptFuture = future;
+    return receipt;
+}
+
+void StompProtocol::handleFlow(const vector<string>& args) {
+    if (!args.empty() && (args[0] == "on" || args[0] == "off")) {
+        flowControl = (args[0] == "on");
+        if (args.size() > 1) {
+            try {
+                flowBatch = max(1, stoi(args[1]));
+            } catch (...) {
+                cout << "Invalid batch size " << args[1] << endl;
+            }
+        }
+        flow.reset(flowBatch, FLOW_INITIAL_BATCHES * flowBatch, FLOW_MAX_BATCHES * flowBatch);
+        cout << "Report flow control " << (flowControl ? "enabled, receipt every " + to_string(flowBatch) + " frames" : "disabled") << endl;
+        return;
+    }
+    if (!args.empty()) {
+        cout << "Usage: flow [on [batch]|off]" << endl;
+        return;
+    }
+    cout << "Flow control " << (flowControl ? "on" : "off") << ": window " << flow.getWindow() << " frames, "
+         << flow.getInFlight() << " in flight, rtt " << flow.getSmoothedRttMicros() << "us (best "
+         << flow.getBaseRttMicros() << "us)" << endl;
+}
+
+void StompProtocol::negotiateHeartbeat(const string& serverHeader) {
+    int sx = 0, sy = 0;
+    size_t comma = serverHeader.find(',');
+    try {
+        if (comma != string::npos) {
+            sx = stoi(serverHeader.substr(0, comma));
+            sy = stoi(serverHeader.substr(comma + 1));
+        }
+    } catch (...) {
+        sx = sy = 0;
+    }
+
+    heartbeatSendMs = (CLIENT_HEARTBEAT_SEND_MS > 0 && sy > 0) ? max(CLIENT_HEARTBEAT_SEND_MS, sy) : 0;
+    // Allow one missed heart-beat before giving up on the server
+    heartbeatReceiveMs = (CLIENT_HEARTBEAT_RECEIVE_MS > 0 && sx > 0) ? 2 * max(CLIENT_HEARTBEAT_RECEIVE_MS, sx) : 0;
+    heartbeatNegotiated = true;
 }
 
 string StompProtocol::buildFrame(string command, map<string, string> headers, string body) {
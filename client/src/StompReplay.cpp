@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/FrameCapture.h"
+#include "../include/StompProtocol.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// Feeds a capture made with the client's capture command back through StompProtocol, the way the
+// listener thread hands frames over, and reports what each frame cost to process:
+//   StompReplay {capture file} [max|speed]
+// max (the default) replays back to back; a speed of 1 keeps the original pacing, 2 twice as fast.
+
+static const size_t SLOWEST_SHOWN = 5;
+
+struct FrameCost {
+    size_t index;
+    uint64_t offsetNs;
+    double ns;
+    string command;
+    string destination;
+
+    FrameCost(size_t index, uint64_t offsetNs, double ns, const string &command, const string &destination)
+        : index(index), offsetNs(offsetNs), ns(ns), command(command), destination(destination) {}
+};
+
+static string firstLine(const string &frame) {
+    return frame.substr(0, frame.find('\n'));
+}
+
+static string headerValue(const string &frame, const string &name) {
+    size_t bodyStart = frame.find("\n\n");
+    size_t at = frame.find("\n" + name + ":");
+    if (at == string::npos || at >= bodyStart) return "";
+    at += name.size() + 2;
+    return frame.substr(at, frame.find('\n', at) - at);
+}
+
+static void report(const string &name, vector<double> &ns) {
+    sort(ns.begin(), ns.end());
+    double total = 0;
+    for (double n : ns) total += n;
+    cout << name << ": " << ns.size() << " frames, p50 " << ns[ns.size() / 2] << " ns, p99 " << ns[ns.size() * 99 / 100]
+         << " ns, max " << ns.back() << " ns, mean " << total / ns.size() << " ns" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " {capture file} [max|speed]" << endl;
+        return 1;
+    }
+    double speed = 0;
+    if (argc > 2 && string(argv[2]) != "max") {
+        speed = atof(argv[2]);
+        if (speed <= 0) {
+            cerr << "Speed must be max or a positive factor, 1 for the original pacing" << endl;
+            return 1;
+        }
+    }
+
+    // Read up front, the disk is not part of what is measured
+    FrameCaptureReader reader;
+    string error;
+    if (!reader.open(argv[1], error)) {
+        cerr << error << endl;
+        return 1;
+    }
+    vector<CapturedFrame> frames;
+    CapturedFrame captured;
+    while (reader.next(captured)) frames.push_back(captured);
+    if (frames.empty()) {
+        cerr << "No frames in " << argv[1] << endl;
+        return 1;
+    }
+    cout << frames.size() << " frames captured over " << frames.back().offsetNs / 1e9 << " s, replaying "
+         << (speed > 0 ? "at " + to_string(speed) + "x" : string("back to back")) << endl;
+
+    // Game updates are printed as they are processed; the terminal is not what is measured here
+    ostringstream discard;
+    streambuf *console = cout.rdbuf(discard.rdbuf());
+
+    StompProtocol protocol;
+    vector<FrameCost> costs;
+    costs.reserve(frames.size());
+    double lateNs = 0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (speed > 0) {
+            auto due = start + chrono::nanoseconds(static_cast<long long>(frames[i].offsetNs / speed));
+            this_thread::sleep_until(due);
+            lateNs = max(lateNs, chrono::duration<double, nano>(Clock::now() - due).count());
+        }
+        auto before = Clock::now();
+        protocol.processServerFrame(frames[i].frame);
+        double ns = chrono::duration<double, nano>(Clock::now() - before).count();
+        costs.push_back(FrameCost(i, frames[i].offsetNs, ns, firstLine(frames[i].frame), headerValue(frames[i].frame, "destination")));
+        // The discarded output would otherwise grow with the capture
+        discard.str("");
+    }
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    cout.rdbuf(console);
+
+    map<string, vector<double>> byCommand;
+    vector<double> all;
+    double busyNs = 0;
+    for (const FrameCost &cost : costs) {
+        byCommand[cost.command].push_back(cost.ns);
+        all.push_back(cost.ns);
+        busyNs += cost.ns;
+    }
+    report("all", all);
+    for (auto &command : byCommand) report(command.first, command.second);
+    cout << static_cast<long>(frames.size() / (busyNs / 1e9)) << " frames/s of processing, replay took " << seconds << " s";
+    if (speed > 0) cout << ", frames started at most " << lateNs / 1000 << " us late";
+    cout << endl;
+
+    size_t shown = min(SLOWEST_SHOWN, costs.size());
+    partial_sort(costs.begin(), costs.begin() + shown, costs.end(),
+                 [](const FrameCost &a, const FrameCost &b) { return a.ns > b.ns; });
+    cout << "slowest frames:" << endl;
+    for (size_t i = 0; i < shown; i++) {
+        cout << "  #" << costs[i].index << " at " << costs[i].offsetNs / 1e6 << " ms: " << costs[i].ns << " ns "
+             << costs[i].command << (costs[i].destination.empty() ? "" : " " + costs[i].destination) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "../include/StringStore.h"
+#include <cstring>
+
+using namespace std;
+
+StringStore::StringStore() : slab(), entries(), index(64, 0), references(0) {}
+
+uint64_t StringStore::hashText(StrView text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < text.size; i++) {
+        hash ^= static_cast<unsigned char>(text.data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint32_t StringStore::acquire(StrView text) {
+    uint64_t hash = hashText(text);
+    size_t mask = index.size() - 1;
+    size_t slot = hash & mask;
+    for (; index[slot] != 0; slot = (slot + 1) & mask) {
+        Entry &entry = entries[index[slot] - 1];
+        if (entry.hash == hash && entry.length == text.size &&
+            memcmp(slab.data() + entry.offset, text.data, text.size) == 0) {
+            entry.refs++;
+            references++;
+            return index[slot] - 1;
+        }
+    }
+
+    Entry entry;
+    entry.hash = hash;
+    entry.offset = static_cast<uint32_t>(slab.size());
+    entry.length = static_cast<uint32_t>(text.size);
+    entry.refs = 1;
+    slab.append(text.data, text.size);
+    entries.push_back(entry);
+    references++;
+    uint32_t id = static_cast<uint32_t>(entries.size() - 1);
+    index[slot] = id + 1;
+
+    // Keep the index at most half full so probe runs stay short
+    if (entries.size() * 2 > index.size()) growIndex();
+    return id;
+}
+
+void StringStore::growIndex() {
+    vector<uint32_t> grown(index.size() * 2, 0);
+    size_t mask = grown.size() - 1;
+    for (size_t id = 0; id < entries.size(); id++) {
+        size_t slot = entries[id].hash & mask;
+        while (grown[slot] != 0) slot = (slot + 1) & mask;
+        grown[slot] = static_cast<uint32_t>(id + 1);
+    }
+    index.swap(grown);
+}
+
+StrView StringStore::get(uint32_t id) const {
+    const Entry &entry = entries[id];
+    return StrView(slab.data() + entry.offset, entry.length);
+}
+
+StringStoreStats StringStore::stats() const {
+    StringStoreStats s;
+    s.strings = entries.size();
+    s.references = references;
+    s.bytesStored = slab.size();
+    s.bytesReferenced = 0;
+    for (auto const &entry : entries) s.bytesReferenced += static_cast<size_t>(entry.length) * entry.refs;
+    s.bytesReserved = slab.capacity() + entries.capacity() * sizeof(Entry) + index.capacity() * sizeof(uint32_t);
+    return s;
+}
@@ -0,0 +1,166 @@
+#include "../include/StructuralIndex.h"
+#include <algorithm>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRUCTURAL_X86 1
+#endif
+
+using namespace std;
+
+static inline bool isStructural(char c) {
+    return c == '\n' || c == ':' || c == '\0';
+}
+
+static size_t scanScalar(const char *data, size_t size, uint32_t *out) {
+    size_t n = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (isStructural(data[i])) out[n++] = static_cast<uint32_t>(i);
+    }
+    return n;
+}
+
+#ifdef STRUCTURAL_X86
+// Turns a bitmask of hits in the block starting at base into offsets
+static inline size_t emitMask(uint32_t mask, size_t base, uint32_t *out) {
+    size_t n = 0;
+    while (mask) {
+        out[n++] = static_cast<uint32_t>(base + __builtin_ctz(mask));
+        mask &= mask - 1;
+    }
+    return n;
+}
+
+__attribute__((target("sse2")))
+static size_t scanSse2(const char *data, size_t size, uint32_t *out) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i zero = _mm_setzero_si128();
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 16));
+        __m128i hitsLo = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(lo, newline), _mm_cmpeq_epi8(lo, colon)), _mm_cmpeq_epi8(lo, zero));
+        __m128i hitsHi = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(hi, newline), _mm_cmpeq_epi8(hi, colon)), _mm_cmpeq_epi8(hi, zero));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hitsLo)) | (static_cast<uint32_t>(_mm_movemask_epi8(hitsHi)) << 16);
+        n += emitMask(mask, i, out + n);
+    }
+    for (; i < size; i++) {
+        if (isStructural(data[i])) out[n++] = static_cast<uint32_t>(i);
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+static size_t scanAvx2(const char *data, size_t size, uint32_t *out) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i zero = _mm256_setzero_si256();
+    size_t n = 0;
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, newline), _mm256_cmpeq_epi8(block, colon)),
+                                       _mm256_cmpeq_epi8(block, zero));
+        n += emitMask(static_cast<uint32_t>(_mm256_movemask_epi8(hits)), i, out + n);
+    }
+    for (; i < size; i++) {
+        if (isStructural(data[i])) out[n++] = static_cast<uint32_t>(i);
+    }
+    return n;
+}
+#endif
+
+bool scanKernelSupported(ScanKernel kernel) {
+#ifdef STRUCTURAL_X86
+    if (kernel == ScanKernel::SSE2) return __builtin_cpu_supports("sse2");
+    if (kernel == ScanKernel::AVX2) return __builtin_cpu_supports("avx2");
+#else
+    if (kernel != ScanKernel::SCALAR) return false;
+#endif
+    return true;
+}
+
+ScanKernel bestScanKernel() {
+    static const ScanKernel best = scanKernelSupported(ScanKernel::AVX2) ? ScanKernel::AVX2
+                                 : scanKernelSupported(ScanKernel::SSE2) ? ScanKernel::SSE2
+                                 : ScanKernel::SCALAR;
+    return best;
+}
+
+const char *scanKernelName(ScanKernel kernel) {
+    switch (kernel) {
+        case ScanKernel::SSE2: return "sse2";
+        case ScanKernel::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+size_t scanStructural(ScanKernel kernel, const char *data, size_t size, uint32_t *out) {
+#ifdef STRUCTURAL_X86
+    if (kernel == ScanKernel::AVX2) return scanAvx2(data, size, out);
+    if (kernel == ScanKernel::SSE2) return scanSse2(data, size, out);
+#endif
+    (void)kernel;
+    return scanScalar(data, size, out);
+}
+
+StructuralIndex StructuralIndex::build(StrView text, FrameArena &arena) {
+    StructuralIndex index;
+    index.base = text.data;
+    uint32_t *positions = arena.allocateArray<uint32_t>(text.size);
+    index.count = scanStructural(bestScanKernel(), text.data, text.size, positions);
+    index.positions = positions;
+    return index;
+}
+
+StructuralIndex StructuralIndex::within(StrView text) const {
+    StructuralIndex sub;
+    sub.base = base;
+    uint32_t from = static_cast<uint32_t>(text.data - base);
+    uint32_t to = static_cast<uint32_t>(from + text.size);
+    const uint32_t *first = lower_bound(positions, positions + count, from);
+    const uint32_t *last = lower_bound(first, positions + count, to);
+    sub.positions = first;
+    sub.count = last - first;
+    return sub;
+}
+
+LineScanner::LineScanner(StrView text, const StructuralIndex &index)
+    : text(text), base(index.base), entry(nullptr), end(nullptr), pos(0) {
+    StructuralIndex inside = index.within(text);
+    entry = inside.positions;
+    end = inside.positions + inside.count;
+}
+
+bool LineScanner::next(StrView &line, size_t &colon) {
+    if (pos >= text.size) return false;
+    size_t offset = text.data - base;
+    colon = string::npos;
+    size_t eol = text.size;
+    for (; entry != end; ++entry) {
+        size_t at = *entry - offset;
+        char c = text.data[at];
+        if (c == '\n') {
+            eol = at;
+            ++entry;
+            break;
+        }
+        if (c == ':' && colon == string::npos) colon = at - pos;
+    }
+    line = text.substr(pos, eol - pos).trimTrailingCr();
+    if (colon != string::npos && colon >= line.size) colon = string::npos;
+    pos = eol + 1;
+    return true;
+}
+
+size_t LineScanner::countLines() const {
+    size_t offset = text.data - base;
+    size_t lines = 0;
+    for (const uint32_t *e = entry; e != end; ++e) {
+        if (text.data[*e - offset] == '\n') lines++;
+    }
+    return lines;
+}
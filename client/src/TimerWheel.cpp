@@ -0,0 +1,57 @@
+#include "../include/TimerWheel.h"
+#include <algorithm>
+
+using namespace std;
+
+TimerWheel::TimerWheel(int tickMs, size_t slotCount)
+    : tickMs(tickMs > 0 ? tickMs : 1), slots(slotCount > 0 ? slotCount : 1), index(),
+      start(Clock::now()), currentTick(0), nextId(1) {}
+
+unsigned long TimerWheel::schedule(int delayMs, Callback callback) {
+    unsigned long ticks = delayMs <= 0 ? 1 : (delayMs + tickMs - 1) / tickMs;
+    // Counted from the clock rather than from currentTick: the owner stops calling advance() while
+    // the wheel is empty, and a delay counted from a stale tick would already be over
+    unsigned long dueTick = max(tickAt(Clock::now()), currentTick) + ticks;
+    size_t slot = dueTick % slots.size();
+
+    unsigned long id = nextId++;
+    slots[slot].push_back(Entry(id, (dueTick - currentTick - 1) / slots.size(), callback));
+    index[id] = make_pair(slot, prev(slots[slot].end()));
+    return id;
+}
+
+bool TimerWheel::cancel(unsigned long timerId) {
+    auto it = index.find(timerId);
+    if (it == index.end()) return false;
+    slots[it->second.first].erase(it->second.second);
+    index.erase(it);
+    return true;
+}
+
+unsigned long TimerWheel::tickAt(Clock::time_point now) const {
+    if (now < start) return 0;
+    return chrono::duration_cast<chrono::milliseconds>(now - start).count() / tickMs;
+}
+
+vector<TimerWheel::Callback> TimerWheel::advance(Clock::time_point now) {
+    vector<Callback> due;
+    unsigned long target = tickAt(now);
+    // Nothing can be due in the ticks an empty wheel skips
+    if (index.empty() && currentTick < target) currentTick = target;
+
+    while (currentTick < target) {
+        currentTick++;
+        list<Entry>& bucket = slots[currentTick % slots.size()];
+        for (auto it = bucket.begin(); it != bucket.end();) {
+            if (it->rounds > 0) {
+                it->rounds--;
+                ++it;
+                continue;
+            }
+            due.push_back(it->callback);
+            index.erase(it->id);
+            it = bucket.erase(it);
+        }
+    }
+    return due;
+}
@@ -0,0 +1,128 @@
+#include "../include/Transport.h"
+#include "../include/UringTransport.h"
+#include <array>
+#include <cerrno>
+#include <poll.h>
+#include <type_traits>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using boost::asio::ip::tcp;
+using boost::asio::local::stream_protocol;
+using std::string;
+
+void Transport::attach(int, boost::system::error_code &error) {
+    error = boost::asio::error::operation_not_supported;
+}
+
+std::vector<string> Transport::tune(const SocketProfile &) {
+    return std::vector<string>();
+}
+
+void Transport::cork(bool) {}
+
+std::unique_ptr<Transport> Transport::fromAddress(const string &address) {
+    if (address.compare(0, 5, "unix:") == 0 && address.size() > 5)
+        return std::unique_ptr<Transport>(new UnixTransport(address.substr(5)));
+
+    std::vector<BrokerEndpoint> brokers;
+    if (!parseBrokerList(address, brokers))
+        return nullptr;
+#ifdef STOMP_IO_URING
+    if (UringTransport::supported())
+        return std::unique_ptr<Transport>(new UringTransport(brokers));
+#endif
+    return std::unique_ptr<Transport>(new TcpTransport(brokers));
+}
+
+template <typename Protocol>
+size_t SocketTransport<Protocol>::readSome(char *buffer, size_t size, int timeoutMs, boost::system::error_code &error) {
+    if (timeoutMs > 0) {
+        // One poll per read, not per byte, so the timeout is cheap on the read path
+        pollfd pfd;
+        pfd.fd = socket_.native_handle();
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready;
+        do {
+            ready = ::poll(&pfd, 1, timeoutMs);
+        } while (ready < 0 && errno == EINTR);
+        if (ready == 0) {
+            error = boost::asio::error::timed_out;
+            return 0;
+        }
+    }
+    size_t read = socket_.read_some(boost::asio::buffer(buffer, size), error);
+    if (profile_.quickAck && std::is_same<Protocol, tcp>::value)
+        rearmQuickAck(socket_.native_handle());
+    return read;
+}
+
+template <typename Protocol>
+void SocketTransport<Protocol>::write(const char *first, size_t firstSize, const char *second, size_t secondSize,
+                                      boost::system::error_code &error) {
+    std::array<boost::asio::const_buffer, 2> buffers = {{boost::asio::buffer(first, firstSize), boost::asio::buffer(second, secondSize)}};
+    boost::asio::write(socket_, buffers, error);
+}
+
+template <typename Protocol>
+void SocketTransport<Protocol>::close() {
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+}
+
+template <typename Protocol>
+std::vector<string> SocketTransport<Protocol>::tune(const SocketProfile &profile) {
+    profile_ = profile;
+    if (!socket_.is_open())
+        return std::vector<string>();
+    return applySocketProfile(socket_.native_handle(), profile, std::is_same<Protocol, tcp>::value);
+}
+
+template <typename Protocol>
+void SocketTransport<Protocol>::cork(bool on) {
+    if (profile_.corkBatches && std::is_same<Protocol, tcp>::value && socket_.is_open())
+        setCork(socket_.native_handle(), on);
+}
+
+template class SocketTransport<tcp>;
+template class SocketTransport<stream_protocol>;
+
+TcpTransport::TcpTransport(const string &host, short port)
+    : brokers_(1, BrokerEndpoint(host, static_cast<unsigned short>(port))) {}
+
+TcpTransport::TcpTransport(const std::vector<BrokerEndpoint> &brokers) : brokers_(brokers) {}
+
+void TcpTransport::connect(boost::system::error_code &error) {
+    int fd = connectFirst(brokers_, CONNECT_TIMEOUT_MS, error);
+    if (fd < 0)
+        return;
+    sockaddr_storage local;
+    socklen_t length = sizeof(local);
+    getsockname(fd, reinterpret_cast<sockaddr *>(&local), &length);
+    socket_.assign(local.ss_family == AF_INET6 ? tcp::v6() : tcp::v4(), fd, error);
+    if (error)
+        ::close(fd);
+}
+
+void TcpTransport::attach(int fd, boost::system::error_code &error) {
+    socket_.assign(tcp::v4(), fd, error);
+}
+
+string TcpTransport::describe() const {
+    return describeBrokers(brokers_);
+}
+
+UnixTransport::UnixTransport(const string &path) : path_(path) {}
+
+void UnixTransport::connect(boost::system::error_code &error) {
+    socket_.connect(stream_protocol::endpoint(path_), error);
+}
+
+void UnixTransport::attach(int fd, boost::system::error_code &error) {
+    socket_.assign(stream_protocol(), fd, error);
+}
+
+string UnixTransport::describe() const {
+    return "unix:" + path_;
+}
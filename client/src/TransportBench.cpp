@@ -0,0 +1,347 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../include/Transport.h"
+#include "../include/ShmTransport.h"
+#include "../include/UringTransport.h"
+#include "../include/ConnectionHandler.h"
+#include <time.h>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// Round trip latency of a frame over each transport, against an echo peer in this process, then
+// receive CPU per frame of a stream of frames read through ConnectionHandler, asio against io_uring,
+// then the socket profiles of SocketTuning.h on TCP:
+//   TransportBench [round trips] [frame bytes] [streamed frames]
+
+static const int WARMUP = 1000;
+
+// Accepts one connection on an already listening socket
+static int acceptOne(int listenFd) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    ::close(listenFd);
+    return fd;
+}
+
+static int listenTcp(unsigned short &port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), length) < 0 || listen(fd, 1) < 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    port = ntohs(address.sin_port);
+    return fd;
+}
+
+static int listenUnix(const string &path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, 1) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Sends back whatever arrives until the client goes away
+static void echo(Transport &server) {
+    vector<char> buffer(64 * 1024);
+    boost::system::error_code error;
+    while (true) {
+        size_t got = server.readSome(buffer.data(), buffer.size(), 0, error);
+        if (error) break;
+        server.write(buffer.data(), got, nullptr, 0, error);
+        if (error) break;
+    }
+}
+
+static void report(const string &name, vector<double> &micros) {
+    if (micros.empty()) {
+        cout << name << ": failed" << endl;
+        return;
+    }
+    sort(micros.begin(), micros.end());
+    double total = 0;
+    for (double m : micros) total += m;
+    cout << name << ": p50 " << micros[micros.size() / 2] << " us, p99 " << micros[micros.size() * 99 / 100]
+         << " us, mean " << total / micros.size() << " us, " << static_cast<long>(micros.size() / (total / 1e6))
+         << " round trips/s" << endl;
+}
+
+// Connects, retrying while the server side is not up yet
+static bool connectClient(Transport &client) {
+    boost::system::error_code error;
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        client.connect(error);
+        if (!error) return true;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    cerr << client.describe() << ": " << error.message() << endl;
+    return false;
+}
+
+// Ping-pong of one frame at a time. openServer connects the server side on the echo thread.
+static vector<double> measure(Transport &client, Transport &server, function<bool()> openServer, int roundTrips,
+                              size_t frameBytes) {
+    vector<double> micros;
+    thread serverThread([&]() {
+        if (openServer()) echo(server);
+    });
+    if (!connectClient(client)) {
+        server.close();
+        serverThread.join();
+        return micros;
+    }
+
+    string frame(frameBytes - 1, 'x');
+    vector<char> reply(frameBytes);
+    const char delimiter = '\0';
+    boost::system::error_code error;
+    for (int i = 0; i < WARMUP + roundTrips && !error; i++) {
+        auto start = Clock::now();
+        client.write(frame.data(), frame.size(), &delimiter, 1, error);
+        for (size_t got = 0; got < frameBytes && !error;)
+            got += client.readSome(reply.data() + got, frameBytes - got, 0, error);
+        if (i >= WARMUP) micros.push_back(chrono::duration<double, micro>(Clock::now() - start).count());
+    }
+    client.close();
+    serverThread.join();
+    server.close();
+    return micros;
+}
+
+static double threadCpuSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// A connected loopback TCP pair, as raw sockets
+static bool connectedPair(int &client, int &server) {
+    unsigned short port = 0;
+    int listener = listenTcp(port);
+    client = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (listener < 0 || connect(client, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        ::close(client);
+        if (listener >= 0) ::close(listener);
+        return false;
+    }
+    server = acceptOne(listener);
+    return server >= 0;
+}
+
+// A peer writes frames as fast as it can; this thread reads them the way the client's listener does
+static void measureReceive(const string &name, unique_ptr<Transport> transport, int frames, size_t frameBytes) {
+    int client, server;
+    if (!connectedPair(client, server)) {
+        cout << name << ": cannot connect over loopback" << endl;
+        return;
+    }
+
+    ConnectionHandler handler(std::move(transport));
+    if (!handler.attach(client)) {
+        ::close(server);
+        return;
+    }
+    thread sender([&]() {
+        string batch;
+        string frame = "MESSAGE\nsubscription:0\nmessage-id:1\ndestination:/bench\n\n" + string(frameBytes, 'x');
+        for (int i = 0; i < frames; i++) {
+            batch += frame;
+            batch += '\0';
+            if (batch.size() >= 256 * 1024 || i == frames - 1) {
+                for (size_t sent = 0; sent < batch.size();) {
+                    ssize_t n = send(server, batch.data() + sent, batch.size() - sent, MSG_NOSIGNAL);
+                    if (n <= 0) return;
+                    sent += n;
+                }
+                batch.clear();
+            }
+        }
+    });
+
+    auto start = Clock::now();
+    double cpuStart = threadCpuSeconds();
+    int received = 0;
+    string frame;
+    while (received < frames && handler.getFrameAscii(frame, '\0')) {
+        received++;
+        frame.clear();
+    }
+    double cpu = threadCpuSeconds() - cpuStart;
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    sender.join();
+    ::close(server);
+    handler.close();
+
+    cout << name << " receive: " << static_cast<long>(received / seconds) << " frames/s, "
+         << static_cast<long>(cpu * 1e9 / max(received, 1)) << " ns CPU per frame" << endl;
+}
+
+// Both ends of a loopback pair with the profile applied
+static bool tunedPair(const SocketProfile &profile, TcpTransport &client, TcpTransport &server) {
+    int clientFd, serverFd;
+    if (!connectedPair(clientFd, serverFd)) return false;
+    boost::system::error_code error;
+    client.attach(clientFd, error);
+    server.attach(serverFd, error);
+    for (const string &refused : client.tune(profile)) cout << "  not applied: " << refused << endl;
+    server.tune(profile);
+    return true;
+}
+
+// How each socket profile does on the two patterns the client produces: a report frame followed by
+// a small frame asking for a receipt, then waiting for it (write-write-read, where Nagle meets
+// delayed ACKs); and commands of 64 report frames, each written on its own, streamed to the broker.
+static void measureProfile(const SocketProfile &profile, int roundTrips, size_t frameBytes, int streamed) {
+    cout << "profile " << profile.name << ":" << endl;
+    {
+        TcpTransport client("127.0.0.1", 0), server("127.0.0.1", 0);
+        if (!tunedPair(profile, client, server)) return;
+        thread broker([&]() {
+            char buffer[64 * 1024];
+            const string receipt = string("RECEIPT\nreceipt-id:1\n\n") + '\0';
+            boost::system::error_code error;
+            int frames = 0;
+            while (true) {
+                size_t got = server.readSome(buffer, sizeof(buffer), 0, error);
+                if (error) break;
+                for (size_t i = 0; i < got; i++) {
+                    if (buffer[i] == '\0' && ++frames % 2 == 0) server.write(receipt.data(), receipt.size(), nullptr, 0, error);
+                }
+            }
+        });
+        string update(frameBytes - 1, 'x');
+        string ask = "SEND\ndestination:/g\nreceipt:1\n\n";
+        const char delimiter = '\0';
+        char reply[256];
+        vector<double> micros;
+        boost::system::error_code error;
+        // Fewer rounds: with Nagle each of them can wait out a delayed ACK (40 ms on Linux)
+        int rounds = min(roundTrips, 200);
+        for (int i = 0; i < rounds && !error; i++) {
+            auto start = Clock::now();
+            client.write(update.data(), update.size(), &delimiter, 1, error);
+            client.write(ask.data(), ask.size(), &delimiter, 1, error);
+            size_t got = 0;
+            while (!error && (got == 0 || reply[got - 1] != '\0'))
+                got += client.readSome(reply + got, sizeof(reply) - got, 0, error);
+            micros.push_back(chrono::duration<double, micro>(Clock::now() - start).count());
+        }
+        client.close();
+        broker.join();
+        server.close();
+        report("  report + receipt round trip", micros);
+    }
+    {
+        TcpTransport client("127.0.0.1", 0), server("127.0.0.1", 0);
+        if (!tunedPair(profile, client, server)) return;
+        size_t total = static_cast<size_t>(streamed) * frameBytes;
+        thread broker([&]() {
+            vector<char> buffer(256 * 1024);
+            boost::system::error_code error;
+            for (size_t received = 0; received < total && !error;)
+                received += server.readSome(buffer.data(), buffer.size(), 0, error);
+            const char done = '\0';
+            server.write(&done, 1, nullptr, 0, error);
+        });
+        string frame(frameBytes - 1, 'x');
+        const char delimiter = '\0';
+        boost::system::error_code error;
+        auto start = Clock::now();
+        for (int i = 0; i < streamed && !error; i += 64) {
+            client.cork(true);
+            for (int j = i; j < min(i + 64, streamed) && !error; j++)
+                client.write(frame.data(), frame.size(), &delimiter, 1, error);
+            client.cork(false);
+        }
+        char done;
+        client.readSome(&done, 1, 0, error);
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+        broker.join();
+        client.close();
+        server.close();
+        cout << "  report stream: " << static_cast<long>(streamed / seconds) << " frames/s, "
+             << total / seconds / 1e6 << " MB/s" << endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int roundTrips = argc > 1 ? stoi(argv[1]) : 20000;
+    size_t frameBytes = argc > 2 ? stoul(argv[2]) : 512;
+    int streamed = argc > 3 ? stoi(argv[3]) : 500000;
+    cout << roundTrips << " round trips of " << frameBytes << " byte frames" << endl;
+
+    unsigned short port = 0;
+    int tcpListener = listenTcp(port);
+    TcpTransport tcpClient("127.0.0.1", port), tcpServer("127.0.0.1", port);
+    vector<double> tcp = measure(tcpClient, tcpServer, [&]() {
+        boost::system::error_code error;
+        tcpServer.attach(acceptOne(tcpListener), error);
+        return !error;
+    }, roundTrips, frameBytes);
+    report("tcp", tcp);
+
+    string path = "/tmp/stomp-transport-bench-" + to_string(getpid()) + ".sock";
+    int unixListener = listenUnix(path);
+    UnixTransport unixClient(path), unixServer(path);
+    vector<double> local = measure(unixClient, unixServer, [&]() {
+        boost::system::error_code error;
+        unixServer.attach(acceptOne(unixListener), error);
+        return !error;
+    }, roundTrips, frameBytes);
+    unlink(path.c_str());
+    report("unix", local);
+
+    string name = "stomp-transport-bench-" + to_string(getpid());
+    ShmTransport shmClient(name, ShmTransport::CLIENT), shmServer(name, ShmTransport::SERVER);
+    vector<double> shm = measure(shmClient, shmServer, [&]() {
+        boost::system::error_code error;
+        shmServer.connect(error);
+        return !error;
+    }, roundTrips, frameBytes);
+    report("shm", shm);
+
+    measureReceive("asio", unique_ptr<Transport>(new TcpTransport("127.0.0.1", 0)), streamed, frameBytes);
+#ifdef STOMP_IO_URING
+    if (UringTransport::supported())
+        measureReceive("io_uring", unique_ptr<Transport>(new UringTransport(vector<BrokerEndpoint>())), streamed, frameBytes);
+    else
+        cout << "io_uring: not available on this kernel" << endl;
+#else
+    cout << "io_uring: not built, use make IO_URING=1" << endl;
+#endif
+
+    for (const string &name : socketProfileNames()) {
+        SocketProfile profile;
+        findSocketProfile(name, profile);
+        measureProfile(profile, roundTrips, frameBytes, streamed);
+    }
+    return 0;
+}
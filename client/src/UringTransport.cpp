@@ -0,0 +1,388 @@
+#ifdef STOMP_IO_URING
+
+#include "../include/UringTransport.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using std::string;
+
+const unsigned UringTransport::RECV_BUFFERS;
+const size_t UringTransport::RECV_BUFFER_BYTES;
+const size_t UringTransport::SEND_BUFFER_BYTES;
+
+// Buffer group of the provided receive buffers
+static const uint16_t BUFFER_GROUP = 0;
+// user_data of the one multishot receive
+static const uint64_t RECV_TAG = 1;
+
+static int uringSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uringRegister(int fd, unsigned opcode, const void *arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+static boost::system::error_code systemError(int code) {
+    return boost::system::error_code(code, boost::system::system_category());
+}
+
+// ---- Ring ----
+
+UringTransport::Ring::Ring()
+    : fd(-1), sqMemory(nullptr), sqBytes(0), cqMemory(nullptr), cqBytes(0), sqes(nullptr), sqesBytes(0),
+      sqHead(nullptr), sqTail(nullptr), sqMask(nullptr), sqArray(nullptr), cqHead(nullptr), cqTail(nullptr),
+      cqMask(nullptr), cqes(nullptr), toSubmit(0) {}
+
+bool UringTransport::Ring::open(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = uringSetup(entries, &params);
+    if (fd < 0)
+        return false;
+    // Waiting with a timeout needs IORING_ENTER_EXT_ARG
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        release();
+        errno = ENOSYS;
+        return false;
+    }
+
+    sqBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+        sqBytes = cqBytes = std::max(sqBytes, cqBytes);
+    sqMemory = mmap(nullptr, sqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqMemory == MAP_FAILED) {
+        sqMemory = nullptr;
+        release();
+        return false;
+    }
+    cqMemory = single ? sqMemory
+                      : mmap(nullptr, cqBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqeMemory = mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (cqMemory == MAP_FAILED || sqeMemory == MAP_FAILED) {
+        if (cqMemory == MAP_FAILED)
+            cqMemory = nullptr;
+        if (sqeMemory != MAP_FAILED)
+            munmap(sqeMemory, sqesBytes);
+        release();
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe *>(sqeMemory);
+
+    char *sq = static_cast<char *>(sqMemory);
+    sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cqMemory);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+}
+
+void UringTransport::Ring::release() {
+    if (sqes)
+        munmap(sqes, sqesBytes);
+    if (cqMemory && cqMemory != sqMemory)
+        munmap(cqMemory, cqBytes);
+    if (sqMemory)
+        munmap(sqMemory, sqBytes);
+    if (fd >= 0)
+        ::close(fd);
+    *this = Ring();
+}
+
+io_uring_sqe *UringTransport::Ring::nextSqe() {
+    unsigned tail = *sqTail;
+    unsigned index = tail & *sqMask;
+    io_uring_sqe *sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    toSubmit++;
+    return sqe;
+}
+
+int UringTransport::Ring::enter(unsigned waitFor, int timeoutMs) {
+    __kernel_timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = timeoutMs > 0 ? reinterpret_cast<uint64_t>(&timeout) : 0;
+
+    unsigned flags = waitFor > 0 ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0;
+    long done;
+    do {
+        done = syscall(__NR_io_uring_enter, fd, toSubmit, waitFor, flags, waitFor > 0 ? &arg : nullptr,
+                       waitFor > 0 ? sizeof(arg) : 0);
+    } while (done < 0 && errno == EINTR);
+    if (done < 0)
+        return -errno;
+    toSubmit -= std::min<unsigned>(toSubmit, static_cast<unsigned>(done));
+    return 0;
+}
+
+// ---- UringTransport ----
+
+UringTransport::UringTransport(const std::vector<BrokerEndpoint> &brokers)
+    : brokers_(brokers), socket_(-1), profile_(), recvRing_(), sendRing_(), bufferRing_(nullptr), bufferRingBytes_(0),
+      recvBuffers_(), bufferTail_(0), receiveArmed_(false), received_(), recvError_(0), sendBuffer_() {}
+
+UringTransport::~UringTransport() {
+    close();
+    tearDown();
+}
+
+bool UringTransport::supported() {
+    static const bool available = []() {
+        std::vector<BrokerEndpoint> none;
+        UringTransport probe(none);
+        boost::system::error_code error;
+        return probe.setUp(error);
+    }();
+    return available;
+}
+
+bool UringTransport::setUp(boost::system::error_code &error) {
+    tearDown();
+    if (!recvRing_.open(RECV_BUFFERS) || !sendRing_.open(8)) {
+        error = systemError(errno);
+        tearDown();
+        return false;
+    }
+
+    // Receive buffers handed to the kernel through a provided buffer ring
+    bufferRingBytes_ = RECV_BUFFERS * sizeof(io_uring_buf);
+    void *ring = mmap(nullptr, bufferRingBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        error = systemError(errno);
+        tearDown();
+        return false;
+    }
+    bufferRing_ = static_cast<io_uring_buf *>(ring);
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufferRing_);
+    reg.ring_entries = RECV_BUFFERS;
+    reg.bgid = BUFFER_GROUP;
+    if (uringRegister(recvRing_.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        error = systemError(errno);
+        tearDown();
+        return false;
+    }
+    recvBuffers_.assign(RECV_BUFFERS * RECV_BUFFER_BYTES, 0);
+    bufferTail_ = 0;
+    for (uint16_t id = 0; id < RECV_BUFFERS; id++)
+        recycle(id);
+
+    // The send buffer is registered once, WRITE_FIXED skips mapping it on every write
+    sendBuffer_.assign(SEND_BUFFER_BYTES, 0);
+    iovec vector;
+    vector.iov_base = sendBuffer_.data();
+    vector.iov_len = sendBuffer_.size();
+    if (uringRegister(sendRing_.fd, IORING_REGISTER_BUFFERS, &vector, 1) < 0) {
+        error = systemError(errno);
+        tearDown();
+        return false;
+    }
+    return true;
+}
+
+void UringTransport::tearDown() {
+    recvRing_.release();
+    sendRing_.release();
+    if (bufferRing_)
+        munmap(bufferRing_, bufferRingBytes_);
+    bufferRing_ = nullptr;
+    receiveArmed_ = false;
+    received_.clear();
+    recvError_ = 0;
+    if (socket_ >= 0)
+        ::close(socket_);
+    socket_ = -1;
+}
+
+void UringTransport::recycle(uint16_t bufferId) {
+    io_uring_buf &entry = bufferRing_[bufferTail_ & (RECV_BUFFERS - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(recvBuffers_.data() + bufferId * RECV_BUFFER_BYTES);
+    entry.len = RECV_BUFFER_BYTES;
+    entry.bid = bufferId;
+    bufferTail_++;
+    // The ring tail overlays the resv field of the first entry
+    __atomic_store_n(&bufferRing_[0].resv, bufferTail_, __ATOMIC_RELEASE);
+}
+
+void UringTransport::connect(boost::system::error_code &error) {
+    error = boost::system::error_code();
+    if (!setUp(error))
+        return;
+    socket_ = connectFirst(brokers_, CONNECT_TIMEOUT_MS, error);
+    if (socket_ < 0)
+        tearDown();
+}
+
+void UringTransport::attach(int fd, boost::system::error_code &error) {
+    error = boost::system::error_code();
+    if (!setUp(error)) {
+        ::close(fd);
+        return;
+    }
+    socket_ = fd;
+}
+
+void UringTransport::armReceive() {
+    io_uring_sqe *sqe = recvRing_.nextSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket_;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = RECV_TAG;
+    receiveArmed_ = true;
+}
+
+void UringTransport::reap() {
+    unsigned head = *recvRing_.cqHead;
+    unsigned tail = __atomic_load_n(recvRing_.cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        const io_uring_cqe &cqe = recvRing_.cqes[head & *recvRing_.cqMask];
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+            receiveArmed_ = false;
+        if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+            received_.push_back(Received(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT), cqe.res));
+        } else if (cqe.res == 0) {
+            recvError_ = -1;
+        } else if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+            // Out of buffers only pauses receiving, it is re-armed once the caller drained some
+            recvError_ = -cqe.res;
+        }
+    }
+    __atomic_store_n(recvRing_.cqHead, head, __ATOMIC_RELEASE);
+}
+
+size_t UringTransport::readSome(char *buffer, size_t size, int timeoutMs, boost::system::error_code &error) {
+    error = boost::system::error_code();
+    if (socket_ < 0) {
+        error = boost::asio::error::bad_descriptor;
+        return 0;
+    }
+    while (received_.empty()) {
+        if (recvError_ != 0) {
+            error = recvError_ < 0 ? boost::system::error_code(boost::asio::error::eof) : systemError(recvError_);
+            return 0;
+        }
+        if (!receiveArmed_)
+            armReceive();
+        int result = recvRing_.enter(1, timeoutMs);
+        if (profile_.quickAck)
+            rearmQuickAck(socket_);
+        if (result == -ETIME) {
+            error = boost::asio::error::timed_out;
+            return 0;
+        }
+        if (result < 0) {
+            error = systemError(-result);
+            return 0;
+        }
+        reap();
+    }
+
+    // Everything already received, across as many completions as fit
+    size_t copied = 0;
+    while (copied < size && !received_.empty()) {
+        Received &next = received_.front();
+        size_t chunk = std::min<size_t>(size - copied, next.length - next.offset);
+        memcpy(buffer + copied, recvBuffers_.data() + next.bufferId * RECV_BUFFER_BYTES + next.offset, chunk);
+        copied += chunk;
+        next.offset += chunk;
+        if (next.offset == next.length) {
+            recycle(next.bufferId);
+            received_.pop_front();
+        }
+    }
+    // Collect whatever arrived meanwhile without entering the kernel
+    reap();
+    return copied;
+}
+
+void UringTransport::write(const char *first, size_t firstSize, const char *second, size_t secondSize,
+                           boost::system::error_code &error) {
+    error = boost::system::error_code();
+    if (socket_ < 0) {
+        error = boost::asio::error::bad_descriptor;
+        return;
+    }
+    size_t total = firstSize + secondSize;
+    for (size_t done = 0; done < total;) {
+        // Gather the next piece of both parts into the registered buffer
+        size_t length = std::min(total - done, SEND_BUFFER_BYTES);
+        size_t filled = 0;
+        if (done < firstSize) {
+            filled = std::min(firstSize - done, length);
+            memcpy(sendBuffer_.data(), first + done, filled);
+        }
+        if (filled < length)
+            memcpy(sendBuffer_.data() + filled, second + (done + filled - firstSize), length - filled);
+
+        for (size_t sent = 0; sent < length;) {
+            io_uring_sqe *sqe = sendRing_.nextSqe();
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->fd = socket_;
+            sqe->addr = reinterpret_cast<uint64_t>(sendBuffer_.data() + sent);
+            sqe->len = static_cast<uint32_t>(length - sent);
+            sqe->buf_index = 0;
+            int result = sendRing_.enter(1, 0);
+            if (result < 0) {
+                error = systemError(-result);
+                return;
+            }
+            unsigned head = *sendRing_.cqHead;
+            int res = sendRing_.cqes[head & *sendRing_.cqMask].res;
+            __atomic_store_n(sendRing_.cqHead, head + 1, __ATOMIC_RELEASE);
+            if (res <= 0) {
+                error = res < 0 ? systemError(-res) : boost::system::error_code(boost::asio::error::broken_pipe);
+                return;
+            }
+            sent += res;
+        }
+        done += length;
+    }
+}
+
+// Ends the multishot receive, so a reader blocked in readSome() sees end of file; the rings stay
+// until the next connect() or destruction
+void UringTransport::close() {
+    if (socket_ >= 0)
+        shutdown(socket_, SHUT_RDWR);
+}
+
+std::vector<string> UringTransport::tune(const SocketProfile &profile) {
+    profile_ = profile;
+    if (socket_ < 0)
+        return std::vector<string>();
+    return applySocketProfile(socket_, profile, true);
+}
+
+void UringTransport::cork(bool on) {
+    if (profile_.corkBatches && socket_ >= 0)
+        setCork(socket_, on);
+}
+
+string UringTransport::describe() const {
+    return describeBrokers(brokers_) + " (io_uring)";
+}
+
+#endif
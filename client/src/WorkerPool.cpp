@@ -0,0 +1,60 @@
+#include "../include/WorkerPool.h"
+
+using namespace std;
+
+WorkerPool::WorkerPool(size_t threads)
+    : threadCount(threads > 0 ? threads : max(1u, thread::hardware_concurrency())), threads(), runMutex(), mutex(),
+      wake(), done(), task(nullptr), count(0), nextIndex(0), finished(0), batch(0), stopping(false) {}
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : threads) t.join();
+}
+
+void WorkerPool::start() {
+    // The calling thread works too, so one less worker is enough
+    for (size_t i = 1; i < threadCount; i++) threads.push_back(thread(&WorkerPool::workerLoop, this));
+}
+
+void WorkerPool::run(size_t count, const Task &task) {
+    if (count == 0) return;
+    lock_guard<std::mutex> serial(runMutex);
+    unique_lock<std::mutex> lock(mutex);
+    if (threads.empty()) start();
+    this->task = &task;
+    this->count = count;
+    nextIndex = 0;
+    finished = 0;
+    batch++;
+    wake.notify_all();
+
+    drain(lock);
+    done.wait(lock, [this] { return finished == this->count; });
+    this->task = nullptr;
+}
+
+void WorkerPool::drain(unique_lock<std::mutex> &lock) {
+    while (task && nextIndex < count) {
+        size_t index = nextIndex++;
+        const Task *current = task;
+        lock.unlock();
+        (*current)(index);
+        lock.lock();
+        if (++finished == count) done.notify_all();
+    }
+}
+
+void WorkerPool::workerLoop() {
+    unique_lock<std::mutex> lock(mutex);
+    unsigned long seen = 0;
+    while (true) {
+        wake.wait(lock, [this, &seen] { return stopping || batch != seen; });
+        if (stopping) return;
+        seen = batch;
+        drain(lock);
+    }
+}
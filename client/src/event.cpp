@@ -1,5 +1,6 @@
 #include "../include/event.h"
 #include "../include/json.hpp"
+#include "../include/EventLoader.h"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -63,83 +64,78 @@ const std::string &Event::get_discription() const
 
 Event::Event(const std::string & frame_body) : team_a_name(""), team_b_name(""), name(""), time(0), game_updates(), team_a_updates(), team_b_updates(), description("")
 {
-    std::stringstream ss(frame_body);
-    std::string line;
-    std::string current_map = ""; 
-
-    while (std::getline(ss, line)) {
-        
-        if (!line.empty() && line.back() == '\r') line.pop_back();
+    static thread_local FrameArena arena(4096);
+    arena.reset();
+    *this = EventView::parse(StrView(frame_body), arena).toEvent();
+}
 
-        
-        if (line.find("user:") == 0) {
-            continue;
-        }
+EventView EventView::parse(StrView body, FrameArena &arena)
+{
+    return parse(body, StructuralIndex::build(body, arena), arena);
+}
 
-        
-        if (line.find("team a:") == 0) {
-            team_a_name = line.substr(7); 
-            continue;
-        }
-        if (line.find("team b:") == 0) {
-            team_b_name = line.substr(7); 
-            continue;
-        }
-        if (line.find("event name:") == 0) {
-            name = line.substr(11); 
-            continue;
+EventView EventView::parse(StrView body, const StructuralIndex &index, FrameArena &arena)
+{
+    EventView view;
+    LineScanner lines(body, index);
+
+    // Every stat takes a line of its own, so the line count bounds the stat array
+    view.stats = arena.allocateArray<StatView>(lines.countLines() + 1);
+
+    int section = -1;   // -1 before the first section header
+    StrView line;
+    size_t colon;
+    while (lines.next(line, colon)) {
+        if (line.equals("description:")) {
+            // The description runs to the end of the body, newlines included
+            view.description = lines.offset() < body.size ? body.substr(lines.offset()).trimTrailingCr() : StrView();
+            break;
         }
-        if (line.find("time:") == 0) {
+        if (line.equals("general game updates:")) section = StatView::GENERAL;
+        else if (line.equals("team a updates:")) section = StatView::TEAM_A;
+        else if (line.equals("team b updates:")) section = StatView::TEAM_B;
+        else if (section < 0 && line.startsWith("user:")) view.user = line.substr(5).trimLeadingSpace();
+        else if (section < 0 && line.startsWith("team a:")) view.team_a_name = line.substr(7).trimLeadingSpace();
+        else if (section < 0 && line.startsWith("team b:")) view.team_b_name = line.substr(7).trimLeadingSpace();
+        else if (section < 0 && line.startsWith("event name:")) view.name = line.substr(11).trimLeadingSpace();
+        else if (section < 0 && line.startsWith("time:")) {
             try {
-                time = std::stoi(line.substr(5)); 
-            } catch (...) { time = 0; } 
-            continue;
+                view.time = std::stoi(line.substr(5).str());
+            } catch (...) { view.time = 0; }
         }
-
-        if (line == "general game updates:") {
-            current_map = "general";
-            continue;
-        }
-        if (line == "team a updates:") {
-            current_map = "team_a";
-            continue;
-        }
-        if (line == "team b updates:") {
-            current_map = "team_b";
-            continue;
-        }
-        if (line == "description:") {
-            current_map = "description";
-            continue; 
+        else if (section >= 0 && colon != std::string::npos) {
+            StatView &stat = view.stats[view.statCount++];
+            stat.section = static_cast<StatView::Section>(section);
+            stat.key = line.substr(0, colon);
+            stat.value = line.substr(colon + 1).trimLeadingSpace();
         }
+    }
+    return view;
+}
 
-        if (current_map == "description") {
-            description += line + "\n";
-        }
-        else if (current_map != "") {
-            size_t colon_pos = line.find(':');
-            if (colon_pos != std::string::npos) {
-                std::string key = line.substr(0, colon_pos);
-                std::string value = line.substr(colon_pos + 1);
-                
-                if (value.size() > 0 && value[0] == ' ') value = value.substr(1);
-
-                if (current_map == "general") {
-                    game_updates[key] = value;
-                } else if (current_map == "team_a") {
-                    team_a_updates[key] = value;
-                } else if (current_map == "team_b") {
-                    team_b_updates[key] = value;
-                }
-            }
-        }
+Event EventView::toEvent() const
+{
+    std::map<std::string, std::string> updates[3];
+    for (size_t i = 0; i < statCount; i++) {
+        updates[stats[i].section][stats[i].key.str()] = stats[i].value.str();
     }
+    // Retained descriptions keep the newline terminated lines the summary expects
+    std::string text = description.str();
+    if (!text.empty() && text.back() != '\n') text += '\n';
+    return Event(team_a_name.str(), team_b_name.str(), name.str(), time, updates[StatView::GENERAL],
+                 updates[StatView::TEAM_A], updates[StatView::TEAM_B], text);
 }
 
 names_and_events parseEventsFile(std::string json_path)
 {
-    std::ifstream f(json_path);
-    json data = json::parse(f);
+    std::ifstream f(json_path, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    // The fixed event schema is loaded straight into Events, anything else goes through nlohmann
+    names_and_events fast;
+    if (f && parseEventsFast(text, fast)) return fast;
+
+    json data = json::parse(text);
 
     std::string team_a_name = data["team a"];
     std::string team_b_name = data["team b"];
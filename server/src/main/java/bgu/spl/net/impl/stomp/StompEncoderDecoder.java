@@ -6,6 +6,9 @@ import java.util.Arrays;
 
 public class StompEncoderDecoder implements MessageEncoderDecoder<String> {
 
+    // A heart-beat is a bare EOL sent between frames (STOMP 1.2)
+    public static final String HEARTBEAT = "\n";
+
     private byte[] bytes = new byte[1 << 10]; // start with 1k
     private int len = 0;
 
@@ -14,6 +17,9 @@ public class StompEncoderDecoder implements MessageEncoderDecoder<String> {
         if (nextByte == '\u0000') {
             return popString();
         }
+        if (len == 0 && (nextByte == '\n' || nextByte == '\r')) {
+            return null; // heart-beat from the client
+        }
 
         pushByte(nextByte);
         return null;
@@ -21,6 +27,9 @@ public class StompEncoderDecoder implements MessageEncoderDecoder<String> {
 
     @Override
     public byte[] encode(String message) {
+        if (HEARTBEAT.equals(message)) {
+            return message.getBytes(StandardCharsets.UTF_8);
+        }
         return (message + "\u0000").getBytes(StandardCharsets.UTF_8);
     }
 
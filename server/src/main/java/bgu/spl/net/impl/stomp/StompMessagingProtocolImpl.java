@@ -6,6 +6,10 @@ import bgu.spl.net.srv.ConnectionsImpl;
 
 import java.util.HashMap;
 import java.util.Map;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.ScheduledFuture;
+import java.util.concurrent.TimeUnit;
 
 import bgu.spl.net.impl.data.Database;
 import bgu.spl.net.impl.data.LoginStatus;
@@ -20,6 +24,15 @@ public class StompMessagingProtocolImpl implements StompMessagingProtocol<String
     private boolean isLoggedIn = false;
     private String currentUser = null; //username
 
+    // Smallest heart-beat interval the server guarantees to send at, in ms
+    private static final int SERVER_HEARTBEAT_MS = 1000;
+    private static final ScheduledExecutorService heartbeatTimer = Executors.newSingleThreadScheduledExecutor(r -> {
+        Thread t = new Thread(r, "stomp-heartbeat");
+        t.setDaemon(true);
+        return t;
+    });
+    private volatile ScheduledFuture<?> heartbeatTask = null;
+
     @Override
     public void start(int connectionId, Connections<String> connections) {
         this.connectionId = connectionId;
@@ -54,6 +67,10 @@ public void process(String message) {
         case "DISCONNECT":
             disconnect(lines);
             break;
+        case "ACK":
+        case "NACK":
+            acknowledge(lines);
+            break;
         default:
             System.out.println("Unknown command: " + command);
             break;
@@ -79,8 +96,11 @@ public void process(String message) {
         case ADDED_NEW_USER:
             isLoggedIn = true;
             this.currentUser = login;
-            String response = "CONNECTED\nversion:" + STOMP_VERSION + "\n";
+            int sendInterval = negotiateHeartbeat(headers.get("heart-beat"));
+            String response = "CONNECTED\nversion:" + STOMP_VERSION + "\n" +
+                              "heart-beat:" + (sendInterval > 0 ? SERVER_HEARTBEAT_MS : 0) + ",0\n";
             connections.send(connectionId, response);
+            startHeartbeat(sendInterval);
             break;
 
         case WRONG_PASSWORD:
@@ -109,6 +129,7 @@ public void process(String message) {
         String body = headers.get("body");
         String receipt = headers.get("receipt"); 
         String filename = headers.get("file");
+        String contentEncoding = headers.get("content-encoding");
 
         if(destination == null || body == null) {
              sendError("Malformed Frame", "Missing destination or body", receipt);
@@ -130,11 +151,14 @@ public void process(String message) {
         for(Map.Entry<Integer, Integer> entry : subscribers.entrySet()){
             int targetConnId = entry.getKey();
             int subId = entry.getValue();
+            boolean needsAck = !((ConnectionsImpl<String>) connections).getAckMode(targetConnId, subId).equals("auto");
 
             String msg = "MESSAGE\n" +
                             "subscription:" + subId + "\n" +
                             "message-id:" + messageId + "\n" +
+                            (needsAck ? "ack:" + messageId + "\n" : "") +
                             "destination:" + destination + "\n" +
+                            (contentEncoding != null ? "content-encoding:" + contentEncoding + "\n" : "") +
                             "\n" +
                             body;
             
@@ -150,7 +174,12 @@ public void process(String message) {
         String destination = headers.get("destination");
         String idStr = headers.get("id");
         String receipt = headers.get("receipt");
+        String ackMode = headers.get("ack");
 
+        if (ackMode != null && !ackMode.equals("auto") && !ackMode.equals("client") && !ackMode.equals("client-individual")) {
+            sendError("Malformed Frame", "Unknown ack mode " + ackMode, receipt);
+            return;
+        }
         if (destination == null || idStr == null) {
             sendError("Malformed Frame", "Missing destination or id header", receipt);
             return;
@@ -158,7 +187,7 @@ public void process(String message) {
 
         try {
             int subId = Integer.parseInt(idStr);
-            ((ConnectionsImpl<String>) connections).subscribe(connectionId, destination, subId);
+            ((ConnectionsImpl<String>) connections).subscribe(connectionId, destination, subId, ackMode);
             handleReceipt(receipt);
         } catch (NumberFormatException e) {
             sendError("Invalid ID", "Subscription ID must be a number", receipt);
@@ -184,11 +213,53 @@ public void process(String message) {
         }
     }
 
+    // Returns how often the server must send heart-beats to this client, 0 if it did not ask for them
+    private int negotiateHeartbeat(String header) {
+        if (header == null) return 0;
+        String[] parts = header.split(",");
+        if (parts.length != 2) return 0;
+        try {
+            int clientWants = Integer.parseInt(parts[1].trim());
+            return clientWants > 0 ? Math.max(clientWants, SERVER_HEARTBEAT_MS) : 0;
+        } catch (NumberFormatException e) {
+            return 0;
+        }
+    }
+
+    private void startHeartbeat(int intervalMs) {
+        if (intervalMs <= 0) return;
+        heartbeatTask = heartbeatTimer.scheduleAtFixedRate(() -> {
+            if (!connections.send(connectionId, StompEncoderDecoder.HEARTBEAT)) {
+                stopHeartbeat();
+            }
+        }, intervalMs, intervalMs, TimeUnit.MILLISECONDS);
+    }
+
+    private void stopHeartbeat() {
+        ScheduledFuture<?> task = heartbeatTask;
+        if (task != null) {
+            task.cancel(false);
+            heartbeatTask = null;
+        }
+    }
+
+    // Messages are not kept for redelivery, so an ACK or NACK only needs a well formed id and its receipt
+    public void acknowledge(String[] lines){
+        Map<String, String> headers = parseHeaders(lines);
+        String receipt = headers.get("receipt");
+        if (headers.get("id") == null) {
+            sendError("Malformed Frame", "Missing id header", receipt);
+            return;
+        }
+        handleReceipt(receipt);
+    }
+
     public void disconnect(String[] lines){
         Map<String, String> headers = parseHeaders(lines);
         String receipt = headers.get("receipt");
         
         Database.getInstance().logout(connectionId);
+        stopHeartbeat();
         handleReceipt(receipt);
         shouldTerminate = true;
         isLoggedIn = false;
@@ -254,11 +325,13 @@ public void process(String message) {
             }
             
             connections.send(connectionId, sb.toString());
+            stopHeartbeat();
             shouldTerminate = true;
             connections.disconnect(connectionId);
     }
     // Called when the connection is closed
     public void close() {
+        stopHeartbeat();
         if (isLoggedIn) {
             System.out.println("Closing connection for user: " + currentUser);
             Database.getInstance().logout(connectionId);
@@ -63,7 +63,7 @@ public class BlockingConnectionHandler<T> implements Runnable, ConnectionHandler
     }
 
     @Override
-    public void send(T msg) {
+    public synchronized void send(T msg) {
         try{
             if(msg != null){
                 out.write(encdec.encode(msg));
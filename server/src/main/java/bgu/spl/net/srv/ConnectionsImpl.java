@@ -18,6 +18,9 @@ public class ConnectionsImpl<T> implements Connections<T> {
     // <connectionId, <subscriberId, channel> managing client subscriptions
     private final Map<Integer, Map<Integer, String>> clientToChannels = new ConcurrentHashMap<>();
 
+    // <connectionId, <subscriberId, ack mode>> for subscriptions that are not "auto"
+    private final Map<Integer, Map<Integer, String>> clientAckModes = new ConcurrentHashMap<>();
+
     private AtomicInteger msgCurrentId = new AtomicInteger(0);
 
     public ConnectionsImpl() {
@@ -49,6 +52,7 @@ public class ConnectionsImpl<T> implements Connections<T> {
 
         // Remove from channelToSubscribers
         // Remove from clientToChannels
+        clientAckModes.remove(connectionId);
         Map<Integer, String> userSubs = clientToChannels.remove(connectionId);
         if (userSubs != null) {
             for (String channel : userSubs.values()) {
@@ -74,7 +78,25 @@ public class ConnectionsImpl<T> implements Connections<T> {
         clientToChannels.get(connectionId).put(subscriberId, channel);
     }
 
+    public void subscribe(int connectionId, String channel, int subscriberId, String ackMode) {
+        subscribe(connectionId, channel, subscriberId);
+        if (ackMode != null && !ackMode.equals("auto")) {
+            clientAckModes.putIfAbsent(connectionId, new ConcurrentHashMap<>());
+            clientAckModes.get(connectionId).put(subscriberId, ackMode);
+        }
+    }
+
+    public String getAckMode(int connectionId, int subscriberId) {
+        Map<Integer, String> modes = clientAckModes.get(connectionId);
+        String mode = modes == null ? null : modes.get(subscriberId);
+        return mode == null ? "auto" : mode;
+    }
+
     public void unsubscribe(int connectionId, int subscriberId) {
+        Map<Integer, String> modes = clientAckModes.get(connectionId);
+        if (modes != null) {
+            modes.remove(subscriberId);
+        }
         Map<Integer, String> userSubs = clientToChannels.get(connectionId);
 
         if (userSubs != null) {